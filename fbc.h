@@ -66,6 +66,90 @@
 // Notes for version 1.7:
 //   1. For single value mode, replace fixed bit mode if singleValueOverFixexBitRepeats.
 //   2. Added 7-bit mode to catch any blocks before failure where all data have high bit clear.
+//
+// Notes for version 1.8:
+//   1. Added frame-of-reference mode for blocks with too many uniques but a narrow range of
+//      values. The minimum value is stored followed by each value less the minimum in 1 to 7
+//      bits. First byte is 0x60, so bits 5-7 of a first byte with no uniques now select the mode:
+//      0 text, 1 single value, 2 7-bit, 3 frame of reference.
+//   2. Fixed decode7bits skipping an output value for block sizes not a multiple of 8.
+//   3. Added nibble mode for 6 to 64 values with at most two unique high nibbles, such as ASCII
+//      digits and packed BCD. The high nibbles are stored in the second byte followed by 4-bit
+//      low nibbles, with a selector bit for two high nibbles. First byte is 0x80.
+//   4. Added fixed alphabet mode for hex chars, which outputs a 4-bit index to the lower or upper
+//      case hex alphabet identified by the second byte. First byte is 0xa0.
+//   5. Nibble and fixed alphabet modes replace 4-bit fixed bit coding when output is smaller.
+//   6. Added base64 and base32 alphabets to fixed alphabet mode, output as 6-bit and 5-bit
+//      indexes. Checked after nibble mode and before frame of reference mode.
+//   7. Added optional repeat block mode through fbc264dedup and fbc264ddedup. A hash table of
+//      recent blocks finds a block identical to one of the previous 4095 blocks of a stream,
+//      which is output as 0xc0 and the distance back in blocks. The decoder copies the block
+//      from its previous output.
+//   8. Added first byte 0xe0 for extended modes identified by the second byte.
+//   9. Added optional XOR prediction through fbc264xor and fbc264dxor. The block is XORed with
+//      the previous block and output as extended mode EXTENDED_XOR_MODE followed by fbc264
+//      output of the XOR values when smaller than fbc264 output of the block.
+//   10. Added optional unique reuse through fbc264reuse and fbc264dreuse. The uniques of the most
+//      recent fixed bit block are kept in a struct fbcUniques_s. A block is output as extended
+//      mode EXTENDED_UNIQUES_MODE with only the uniques added to that list, followed by an index
+//      for each value, when smaller than fbc264 output of the block.
+//   11. Added fbc264size and fbc25size to get the number of compressed bytes without decoding.
+//   12. Added record framing for streams of variable length records. fbcRecordsEncode outputs
+//      each record with a varint prefix of its length and a compressed bit, followed by its
+//      compressed or original bytes. fbcRecordNext steps through records without copying and
+//      fbcRecordDecode decodes any one record.
+//   13. Input values to encode functions are const.
+//   14. Added fbckv.h, a key-value store of values up to 64 bytes kept compressed by fbc264,
+//      with fbckvbench.c to compare it with the same store uncompressed.
+//   15. Fixed read of val256[-1] in fbc264 when no single value candidate and 9 or more uniques.
+//   16. Added fbccol.h, a column of values up to 64 bytes compressed by fbc264, packed back to
+//      back with an offsets array for random access.
+//   17. Added fbc264filter to evaluate ==, !=, <, > and in-set predicates on a compressed
+//      block. Fixed bit, single value and 7-bit blocks are evaluated without decoding.
+//   18. Added fbc264histogram, fbc264minmax and fbc264count aggregates on a compressed block,
+//      and fbcStreamHistogram for a stream of blocks from the test bed.
+//   19. Added fbc264dcodes, fbc264dcodes16 and fbc264dcodes32 to decode a block as a table of
+//      up to 16 uniques and an index to the table for each value.
+//   20. Added fbc264dat and fbc264drange to decode only some values of a block.
+//   21. Added fbc264positions to find the positions of consecutive blocks.
+//   22. Added fbc25batch and fbc25dbatch for arrays of records of 2 to 5 bytes, with a
+//      length for each record.
+//   23. Added fixed-rate mode through fbc264fixedrate and fbc264dfixedrate. Compressed blocks
+//      are padded to a fixed number of bytes and other blocks are not compressed, so
+//      fbcFixedRatePosition finds any block from the compressed or not bits.
+//   24. Added leadingZeros64. The test bed copies runs of uncompressed blocks with one memcpy
+//      and decodes runs of compressed blocks found from leading zeros of the compressed or not bits.
+//   25. Added optional skipping of incompressible regions through fbc264skip. After a run of
+//      blocks that do not compress, blocks are tried at growing intervals and the blocks
+//      between are output uncompressed, until a tried block compresses.
+//   26. Added fbc264mode to get the mode of a compressed block, and optional mode prediction
+//      through fbc264predict, which tries the mode of the previous block before fbc264.
+//   27. Moved fixed bit coding of fbc264 to encodeFixedBit. Added compression levels through
+//      fbc264level, where level 1 outputs the mode with the smallest exact output size.
+//   28. Added large blocks of 65 to 256 values to fbc264 and fbc264d. The first byte selects the
+//      mode as for 64 values. Text and single value modes keep up to 256 control bits in 4 words.
+//      fbc264large outputs the mode with the smallest size as the count pass is a small part
+//      of encoding a large block. fbc264size accepts large blocks, so streams of them can be
+//      walked by fbc264positions.
+//   29. Added optional static Huffman mode through fbc264huffman and fbc264dhuffman. A block is
+//      output as extended mode EXTENDED_HUFFMAN_MODE with canonical Huffman codes from one of up
+//      to 16 tables, built-in for text and binary data or built from training counts.
+//   30. Added fbc264dfast, which decodes blocks of 2 uniques 8 values at a time into a 64-bit
+//      word without checking for the end of the block, writing up to FBC_SLACK_BYTES past it.
+//      The tails of 7-bit mode are copied with one memcpy in encode7bits and decode7bits.
+//   31. Added fbcStreamDecodeInPlace to decode a stream of blocks into the buffer that holds it
+//      at its end, with fbcInPlaceBound giving the buffer size that guarantees unread input is
+//      never overwritten. fbc264 no longer outputs 7-bit or single value mode for blocks where
+//      the output is larger than the input, which could happen for fewer than 16 values.
+//   32. Added fbcCompressBuffer and fbcDecompressBuffer to compress a whole buffer into one
+//      self-contained stream of a header, compressed or not bits and blocks, with
+//      fbcCompressBound giving its max size and fbcDecompressedSize its original size.
+//   33. fbc264 outputs nibble or fixed alphabet mode instead of text mode for blocks of hex,
+//      base32 or base64 chars when smaller, and fbc264predict tries nibble mode for blocks
+//      predicted to be fixed alphabet mode since hex alphabet blocks are nibble mode output.
+//   34. Fixed alphabet mode counts up to 6 '=' padding chars at the end of a base64 or base32
+//      block in the high 4 bits of the alphabet id instead of failing on them. '=' anywhere
+//      else in a block is not handled.
 
 #ifndef fbc_h
 #define fbc_h
@@ -75,8 +159,50 @@
 #include <stdlib.h>
 
 #define MAX_FBC_BYTES 64  // max input vals supported
+#define MAX_FBC_LARGE_BYTES 256  // max input vals supported by fbc264 and fbc264d for large blocks
 #define MIN_FBC_BYTES 2  // min input vals supported
 #define MAX_UNIQUES 16 // max uniques supported in input
+#define DEDUP_HASH_BITS 12 // hash table of 4096 recent blocks for repeat block mode
+#define DEDUP_WINDOW_BLOCKS 4096 // max distance back to a repeated block
+#define SKIP_TRIGGER_FAILURES 8 // blocks in a row not compressed before fbc264skip starts skipping
+#define SKIP_MAX_BLOCKS 15 // max blocks skipped between blocks tried by fbc264skip
+#define PREDICT_CHECK_BLOCKS 16 // max blocks in a row encoded by fbc264predict without fbc264
+
+// extended modes have first byte 0xe0 and the mode in the low 4 bits of the second byte
+#define EXTENDED_XOR_MODE 0 // block XOR previous block encoded by fbc264
+#define EXTENDED_UNIQUES_MODE 1 // indexes to previous block's uniques plus added uniques
+#define EXTENDED_HUFFMAN_MODE 2 // Huffman codes of a table identified in the high 4 bits
+
+// static Huffman mode tables
+#define HUFFMAN_MAX_BITS 11 // max code length and bits decoded by one table lookup
+#define HUFFMAN_TABLES 16 // table ids 0 to 15
+#define HUFFMAN_TEXT_TABLE 0 // built-in table for English text
+#define HUFFMAN_BINARY_TABLE 1 // built-in table for binary data
+
+// bytes after an output buffer that fbc264dfast may write
+#define FBC_SLACK_BYTES 16
+
+// max bytes of the header of fbcCompressBuffer output: original size in up to 10 bytes and block size
+#define FBC_BUFFER_HEADER_BYTES 11
+
+// block modes returned by fbc264mode
+#define FBC_MODE_FIXED_BIT 0 // 1 to 16 uniques
+#define FBC_MODE_TEXT 1
+#define FBC_MODE_SINGLE_VALUE 2
+#define FBC_MODE_7BIT 3
+#define FBC_MODE_FRAME_OF_REFERENCE 4
+#define FBC_MODE_NIBBLE 5
+#define FBC_MODE_FIXED_ALPHABET 6
+#define FBC_MODE_REPEAT_BLOCK 7
+#define FBC_MODE_EXTENDED 8
+#define FBC_MODE_NONE 9 // not compressed
+
+// predicate operators for fbc264filter
+#define FBC_PREDICATE_EQ 0 // value == predicate value
+#define FBC_PREDICATE_NE 1 // value != predicate value
+#define FBC_PREDICATE_LT 2 // value < predicate value
+#define FBC_PREDICATE_GT 3 // value > predicate value
+#define FBC_PREDICATE_IN 4 // value in predicate set
 
 // ----------------------------------------------
 // for the number of uniques in input, the minimum number of input values for 25% compression
@@ -147,6 +273,90 @@ static const uint32_t textEncoding[256]={
     16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16
 };
 
+// alphabet ids stored in the low 4 bits of the second byte of fixed alphabet mode
+#define HEX_LOWER_ALPHABET 0
+#define HEX_UPPER_ALPHABET 1
+#define BASE64_ALPHABET 2
+#define BASE32_ALPHABET 3
+// max '=' padding chars at the end of a base64 or base32 block, stored in the high 4 bits
+#define MAX_ALPHABET_PAD_CHARS 6
+static const unsigned char hexChars[2][16]={
+    {'0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f'},
+    {'0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'A', 'B', 'C', 'D', 'E', 'F'}
+};
+
+// index to hex char in low 4 bits, 16 added if not a lower case hex char, 32 added if not upper case
+static const uint32_t hexEncoding[256]={
+    48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48,
+    48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48,
+    48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48,
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 48, 48, 48, 48, 48, 48,
+    48, 26, 27, 28, 29, 30, 31, 48, 48, 48, 48, 48, 48, 48, 48, 48,
+    48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48,
+    48, 42, 43, 44, 45, 46, 47, 48, 48, 48, 48, 48, 48, 48, 48, 48,
+    48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48,
+    48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48,
+    48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48,
+    48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48,
+    48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48,
+    48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48,
+    48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48,
+    48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48,
+    48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48
+};
+
+static const unsigned char base64Chars[64]={
+    'A', 'B', 'C', 'D', 'E', 'F', 'G', 'H', 'I', 'J', 'K', 'L', 'M', 'N', 'O', 'P',
+    'Q', 'R', 'S', 'T', 'U', 'V', 'W', 'X', 'Y', 'Z', 'a', 'b', 'c', 'd', 'e', 'f',
+    'g', 'h', 'i', 'j', 'k', 'l', 'm', 'n', 'o', 'p', 'q', 'r', 's', 't', 'u', 'v',
+    'w', 'x', 'y', 'z', '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', '+', '/'
+};
+
+// index to base64 char or 64 if another value
+static const uint32_t base64Encoding[256]={
+    64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64,
+    64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64,
+    64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 62, 64, 64, 64, 63,
+    52, 53, 54, 55, 56, 57, 58, 59, 60, 61, 64, 64, 64, 64, 64, 64,
+    64, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14,
+    15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 64, 64, 64, 64, 64,
+    64, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40,
+    41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, 64, 64, 64, 64, 64,
+    64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64,
+    64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64,
+    64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64,
+    64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64,
+    64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64,
+    64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64,
+    64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64,
+    64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64
+};
+
+static const unsigned char base32Chars[32]={
+    'A', 'B', 'C', 'D', 'E', 'F', 'G', 'H', 'I', 'J', 'K', 'L', 'M', 'N', 'O', 'P',
+    'Q', 'R', 'S', 'T', 'U', 'V', 'W', 'X', 'Y', 'Z', '2', '3', '4', '5', '6', '7'
+};
+
+// index to base32 char or 32 if another value
+static const uint32_t base32Encoding[256]={
+    32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32,
+    32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32,
+    32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32,
+    32, 32, 26, 27, 28, 29, 30, 31, 32, 32, 32, 32, 32, 32, 32, 32,
+    32, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14,
+    15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 32, 32, 32, 32, 32,
+    32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32,
+    32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32,
+    32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32,
+    32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32,
+    32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32,
+    32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32,
+    32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32,
+    32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32,
+    32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32,
+    32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32
+};
+
 // -----------------------------------------------------------------------------------
 static inline int32_t fbc25(const unsigned char *inVals, unsigned char *outVals, const uint32_t nValues)
 // -----------------------------------------------------------------------------------
@@ -461,13 +671,13 @@ static inline int32_t fbc25d(const unsigned char *inVals, unsigned char *outVals
 } // end fbc25d
 
 // -----------------------------------------------------------------------------------
-static inline int32_t encodeTextMode(unsigned char *inVals, unsigned char *outVals, const uint32_t nValues)
+static inline int32_t encodeTextMode(const unsigned char *inVals, unsigned char *outVals, const uint32_t nValues)
 // -----------------------------------------------------------------------------------
 {
     // if value is predefined, use its index; otherwise, output 8-bit value
     // generate control bit 1 if predefined text char, 0 if 8-bit value
-    unsigned char *pInVal=inVals;
-    unsigned char *pLastInValPlusOne=inVals+nValues;
+    const unsigned char *pInVal=inVals;
+    const unsigned char *pLastInValPlusOne=inVals+nValues;
     uint32_t inVal;
     uint32_t nextOutVal=(nValues-1)/8+2; // allocate space for control bits in bytes following first
     uint64_t controlByte=0;
@@ -575,12 +785,12 @@ static inline int32_t encodeTextMode(unsigned char *inVals, unsigned char *outVa
 } // end encodeTextMode
 
 // -----------------------------------------------------------------------------------
-static inline int32_t encodeSingleValueMode(unsigned char *inVals, unsigned char *outVals, const uint32_t nValues, int32_t singleValue)
+static inline int32_t encodeSingleValueMode(const unsigned char *inVals, unsigned char *outVals, const uint32_t nValues, int32_t singleValue)
 // -----------------------------------------------------------------------------------
 {
     // generate control bit 1 if single value, otherwise 0 plus 8-bit value
-    unsigned char *pInVal=inVals;
-    unsigned char *pLastInValPlusOne=inVals+nValues;
+    const unsigned char *pInVal=inVals;
+    const unsigned char *pLastInValPlusOne=inVals+nValues;
     uint32_t inVal;
     uint32_t nextOutVal=(nValues-1)/8+2; // allocate space for control bits in bytes following first
     uint64_t controlByte=0;
@@ -693,162 +903,222 @@ static inline int32_t encode7bits(const unsigned char *inVals, unsigned char *ou
         val2 = inVals[nextInVal++];
         outVals[nextOutVal++] = (unsigned char)((val1 >> 6) | (val2 << 1));
     }
-    while (nextInVal < nValues)
-    {
-        // output final values as full bytes because no bytes saved, only bits
-        outVals[nextOutVal++] = inVals[nextInVal++];
-        if (nextInVal == nValues)
-            break;
-        outVals[nextOutVal++] = inVals[nextInVal++];
-        if (nextInVal == nValues)
-            break;
-        outVals[nextOutVal++] = inVals[nextInVal++];
-        if (nextInVal == nValues)
-            break;
-        outVals[nextOutVal++] = inVals[nextInVal++];
-        if (nextInVal == nValues)
-            break;
-        outVals[nextOutVal++] = inVals[nextInVal++];
-        if (nextInVal == nValues)
-            break;
-        outVals[nextOutVal++] = inVals[nextInVal++];
-        if (nextInVal == nValues)
-            break;
-        outVals[nextOutVal++] = inVals[nextInVal++];
-            break;
-    }
+    // output final 0 to 7 values as full bytes because no bytes saved, only bits
+    memcpy(outVals+nextOutVal, inVals+nextInVal, nValues-nextInVal);
+    nextOutVal += nValues - nextInVal;
     return (int32_t)nextOutVal*8;
 } // end encode7bits
 
 // -----------------------------------------------------------------------------------
-static inline int32_t fbc264(unsigned char *inVals, unsigned char *outVals, const uint32_t nValues)
+static inline int32_t encodeFrameOfReference(const unsigned char *inVals, unsigned char *outVals, const uint32_t nValues)
 // -----------------------------------------------------------------------------------
-// fbc264: Compress nValues bytes. Return 0 if not compressible (no output bytes),
-//    -1 if error; otherwise, number of bits written to outVals.
-//    Management of whether compressible and number of input values must be maintained
-//    by caller. Decdode requires number of input values and only accepts compressed data.
-// Arguments:
-//   inVals   input byte values
-//   outVals  output byte values if compressed, max of inVals bytes
-//   nValues  number of input byte values
-// Returns number of bits compressed, 0 if not compressed, or -1 if error
 {
-    if (nValues <= 5)
-        return fbc25(inVals, outVals, nValues);
-    
-    if (nValues > MAX_FBC_BYTES)
-        return -1; // only values 2 to 64 supported
-    
-    unsigned char *pInVal;
-    uint32_t highBitCheck=0;
-    uint32_t predefinedTextCharCnt=0; // count of text chars encountered
-    uint32_t uniqueOccurrence[256]; // order of occurrence of uniques
-    uint32_t nUniqueVals=0; // count of unique vals encountered
-    unsigned char val256[256];
-    const uint32_t uniqueLimit=uniqueLimits25[nValues]; // if exceeded, return uncompressible by fixed bit coding
-    memset(val256, 0, sizeof(val256));
-    const uint32_t nValsInitLoop=(nValues*5/16)+1;
+    // output minimum value followed by 3 bits of width-1 and each value less the minimum in width bits
+    // return 0 if the range of values requires 8 bits or output is not smaller than 7-bit mode
+    const unsigned char *pInVal=inVals;
     const unsigned char *pLastInValPlusOne=inVals+nValues;
-    const unsigned char *pLimitInVals=inVals+nValsInitLoop; // fewest values to test for text mode
-
-    // process enough input vals to eliminate most random data and to check for text mode
-    // for fixed bit coding find and output the uniques starting at outVal[1]
-    //    and saving the unique occurrence value to be used when values are output
-    // for 7 bit mode OR every value
-    // for text mode count number of text characters
-    // for single value mode accumulate frequency counts
+    uint32_t minVal=*pInVal;
+    uint32_t maxVal=*pInVal;
+    while (++pInVal < pLastInValPlusOne)
+    {
+        uint32_t inVal=*pInVal;
+        if (inVal < minVal)
+            minVal = inVal;
+        else if (inVal > maxVal)
+            maxVal = inVal;
+        if (maxVal - minVal > 127)
+            return 0; // full 8 bits required, random data fails here
+    }
+    uint32_t width=1;
+    while ((maxVal - minVal) >> width)
+        width++;
+    const uint32_t nBits=19 + nValues * width; // first byte, minimum, 3 width bits plus values
+    const uint32_t nBytes=(nBits + 7) / 8;
+    if (nBytes >= nValues)
+        return 0; // data failed to compress
+    if ((maxVal < 128) && (nBytes >= 1 + nValues - nValues/8))
+        return 0; // 7-bit mode is at least as good
+    
+    outVals[0] = 0x60; // indicate frame of reference mode
+    outVals[1] = (unsigned char)minVal;
+    uint32_t nextOutVal=2;
+    uint64_t encodingBits=width-1;
+    uint32_t nEncodingBits=3;
     pInVal = inVals;
-    while (pInVal < pLimitInVals)
+    while (pInVal < pLastInValPlusOne)
+    {
+        encodingBits |= (uint64_t)(*(pInVal++) - minVal) << nEncodingBits;
+        nEncodingBits += width;
+        if (nEncodingBits >= 8)
+        {
+            outVals[nextOutVal++] = (unsigned char)encodingBits;
+            encodingBits >>= 8;
+            nEncodingBits -= 8;
+        }
+    }
+    if (nEncodingBits)
+        outVals[nextOutVal] = (unsigned char)encodingBits; // output last partial byte
+    return (int32_t)nBits;
+} // end encodeFrameOfReference
+
+// -----------------------------------------------------------------------------------
+static inline int32_t encodeNibbleMode(const unsigned char *inVals, unsigned char *outVals, const uint32_t nValues, const uint32_t maxBits)
+// -----------------------------------------------------------------------------------
+{
+    // values with at most two unique high nibbles output the low nibble in 4 bits, preceded by
+    // a selector bit for the high nibble when there are two; hex chars with two high nibbles
+    // output a 4-bit index to the hex alphabet instead
+    // return 0 if any value fails or output is not fewer bytes than maxBits
+    const unsigned char *pInVal=inVals;
+    const unsigned char *pLastInValPlusOne=inVals+nValues;
+    uint32_t highNibbleBits=0; // a one for each high nibble encountered
+    uint32_t highNibbles[2]={0, 0};
+    uint32_t nHighNibbles=0;
+    uint32_t hexCheck=0; // 48 if neither lower nor upper case hex chars
+    uint32_t nextOutVal=2;
+    uint32_t nBits;
+    
+    while (pInVal < pLastInValPlusOne)
     {
         uint32_t inVal=*(pInVal++);
-        highBitCheck |= inVal;
-        predefinedTextCharCnt += predefinedTextChars[inVal]; // count text chars for text char mode
-        if (val256[inVal]++ == 0)
+        hexCheck |= hexEncoding[inVal];
+        if ((highNibbleBits & (1 << (inVal >> 4))) == 0)
         {
-            // first occurrence of value, for fixed bit coding:
-            uniqueOccurrence[inVal] = nUniqueVals; // save occurrence count for this unique
-            outVals[++nUniqueVals] = (unsigned char)inVal; // store unique starting at second byte
+            if (nHighNibbles == 2)
+                return 0; // more than two high nibbles, random data fails here
+            highNibbleBits |= 1 << (inVal >> 4);
+            highNibbles[nHighNibbles++] = inVal >> 4;
         }
     }
-    if (nUniqueVals > uniqueLimit)
+    if ((nHighNibbles == 2) && ((hexCheck & 48) != 48))
     {
-        // supported unique values exceeded
-        if ((highBitCheck & 0x80) == 0)
+        // fixed alphabet mode: 4-bit index to hex char
+        nBits = 16 + nValues * 4;
+        if ((nBits + 7) / 8 >= (maxBits + 7) / 8)
+            return 0; // data failed to compress
+        outVals[0] = 0xa0; // indicate fixed alphabet mode
+        outVals[1] = (hexCheck & 16) ? HEX_UPPER_ALPHABET : HEX_LOWER_ALPHABET;
+        pInVal = inVals;
+        while (pInVal + 1 < pLastInValPlusOne)
         {
-            // attempt to compress based on high bit clear across all values
-            // confirm remaining values have high bit clear
-            while (pInVal < pLastInValPlusOne)
-                highBitCheck |= *pInVal++;
-            if ((highBitCheck & 0x80) == 0)
-                return encode7bits(inVals, outVals, nValues);
+            uint32_t encodingByte=hexEncoding[*(pInVal++)] & 0xf;
+            outVals[nextOutVal++] = (unsigned char)(encodingByte | ((hexEncoding[*(pInVal++)] & 0xf) << 4));
         }
-        return 0; // too many uniques to compress with fixed bit coding, random data fails here
+        if (pInVal < pLastInValPlusOne)
+            outVals[nextOutVal] = (unsigned char)(hexEncoding[*pInVal] & 0xf);
+        return (int32_t)nBits;
     }
-    if (nUniqueVals > uniqueLimits25[nValsInitLoop] * 3/4 + 1)
+    if (nHighNibbles == 1)
     {
-        // make sure at least 3/4 of uniques for the initial number of values is exceeded
-        //    because fixed bit coding will produce higher compression
-        // check text mode validity as it's not considered after this
-        // text mode will have 3/4 text values, but for smaller numbers, use .5
-        // this number of values will almost always compress, though 1/4 of data must be text
-        // chars to compress; encodeTextMode verifies compression occurs
-        if (predefinedTextCharCnt > nValsInitLoop / 2)
+        // 4-bit low nibbles with single high nibble
+        nBits = 16 + nValues * 4;
+        if ((nBits + 7) / 8 >= (maxBits + 7) / 8)
+            return 0; // data failed to compress
+        outVals[0] = 0x80; // indicate nibble mode
+        outVals[1] = (unsigned char)(highNibbles[0] | (highNibbles[0] << 4)); // same high nibble twice
+        pInVal = inVals;
+        while (pInVal + 1 < pLastInValPlusOne)
         {
-            // compress in text mode
-            return encodeTextMode(inVals, outVals, nValues);
+            uint32_t encodingByte=*(pInVal++) & 0xf;
+            outVals[nextOutVal++] = (unsigned char)(encodingByte | (*(pInVal++) << 4));
         }
+        if (pInVal < pLastInValPlusOne)
+            outVals[nextOutVal] = (unsigned char)(*pInVal & 0xf);
+        return (int32_t)nBits;
     }
-    // continue fixed bit loop with checks for high bit set and repeat counts
-    // look for minimum count to validate single value mode
-    const uint32_t singleValueOverFixexBitRepeats=nValsInitLoop*3/2;
-    const uint32_t minRepeatsSingleValueMode=(unsigned char)nValues/4+1;
-    int32_t singleValue=-1; // look for value that repeats MIN_REPEATS_SINGLE_VALUE_MODE
+    // 5-bit values: selector bit for high nibble above 4-bit low nibble
+    nBits = 16 + nValues * 5;
+    if ((nBits + 7) / 8 >= (maxBits + 7) / 8)
+        return 0; // data failed to compress
+    outVals[0] = 0x80; // indicate nibble mode
+    outVals[1] = (unsigned char)(highNibbles[0] | (highNibbles[1] << 4));
+    uint64_t encodingBits=0;
+    uint32_t nEncodingBits=0;
+    pInVal = inVals;
     while (pInVal < pLastInValPlusOne)
     {
         uint32_t inVal=*(pInVal++);
-        highBitCheck |= inVal;
-        if (val256[inVal]++ == 0)
-        {
-            // first occurrence of value, for fixed bit coding:
-            uniqueOccurrence[inVal] = nUniqueVals; // save occurrence count for this unique
-            outVals[++nUniqueVals] = (unsigned char)inVal; // store unique starting at second byte
-        }
-        else if (val256[inVal] >= minRepeatsSingleValueMode)
+        encodingBits |= (uint64_t)((inVal & 0xf) | (((inVal >> 4) == highNibbles[1]) << 4)) << nEncodingBits;
+        nEncodingBits += 5;
+        if (nEncodingBits >= 8)
         {
-            singleValue = (int32_t)inVal;
-            break; // continue loop without further checking
+            outVals[nextOutVal++] = (unsigned char)encodingBits;
+            encodingBits >>= 8;
+            nEncodingBits -= 8;
         }
     }
-    // continue fixed bit loop with checks for high bit set and repeat counts
+    if (nEncodingBits)
+        outVals[nextOutVal] = (unsigned char)encodingBits; // output last partial byte
+    return (int32_t)nBits;
+} // end encodeNibbleMode
+
+// -----------------------------------------------------------------------------------
+static inline int32_t encodeFixedAlphabet(const unsigned char *inVals, unsigned char *outVals, const uint32_t nValues)
+// -----------------------------------------------------------------------------------
+{
+    // values that are all base32 chars output a 5-bit index to the base32 alphabet,
+    // otherwise all base64 chars output a 6-bit index to the base64 alphabet
+    // up to MAX_ALPHABET_PAD_CHARS '=' padding chars at the end are counted, not output
+    // hex chars are output by encodeNibbleMode
+    // return 0 if any value is in neither alphabet or output is not fewer bytes than input
+    const unsigned char *pInVal=inVals;
+    const unsigned char *pLastInValPlusOne=inVals+nValues;
+    uint32_t base64Check=0; // 64 if not all base64 chars
+    uint32_t base32Check=0; // 32 if not all base32 chars
+    uint32_t nPadChars=0;
+    
+    while ((nPadChars < MAX_ALPHABET_PAD_CHARS) && (nPadChars + 1 < nValues) && (pLastInValPlusOne[-1] == '='))
+    {
+        pLastInValPlusOne--;
+        nPadChars++;
+    }
     while (pInVal < pLastInValPlusOne)
     {
         uint32_t inVal=*(pInVal++);
-        highBitCheck |= inVal;
-        if (val256[inVal]++ == 0)
-        {
-            // first occurrence of value, for fixed bit coding:
-            uniqueOccurrence[inVal] = nUniqueVals; // save occurrence count for this unique
-            outVals[++nUniqueVals] = (unsigned char)inVal; // store unique starting at second byte
-        }
+        base64Check |= base64Encoding[inVal];
+        base32Check |= base32Encoding[inVal];
+        if ((base64Check & 64) && (base32Check & 32))
+            return 0; // not in either alphabet, random data fails here
     }
-    if (nUniqueVals > uniqueLimit)
+    const uint32_t *pAlphabetEncoding=base64Encoding;
+    uint32_t width=6;
+    outVals[1] = (unsigned char)(BASE64_ALPHABET | (nPadChars << 4));
+    if ((base32Check & 32) == 0)
     {
-        // fixed bit coding fails, try for other compression modes
-        if (singleValue >= 0)
-        {
-            return encodeSingleValueMode(inVals, outVals, nValues, singleValue);
-        }
-        if ((highBitCheck & 0x80) == 0)
-            return encode7bits(inVals, outVals, nValues);
-        return 0; // too many uniques to compress
+        pAlphabetEncoding = base32Encoding;
+        width = 5;
+        outVals[1] = (unsigned char)(BASE32_ALPHABET | (nPadChars << 4));
     }
-    else if ((nUniqueVals > 8) && (val256[singleValue] >= singleValueOverFixexBitRepeats))
+    const uint32_t nBits=16 + (nValues - nPadChars) * width;
+    if ((nBits + 7) / 8 >= nValues)
+        return 0; // data failed to compress
+    
+    outVals[0] = 0xa0; // indicate fixed alphabet mode
+    uint32_t nextOutVal=2;
+    uint64_t encodingBits=0;
+    uint32_t nEncodingBits=0;
+    pInVal = inVals;
+    while (pInVal < pLastInValPlusOne)
     {
-        // favor single value over 12 value fixed 4-bit encoding
-        return encodeSingleValueMode(inVals, outVals, nValues, singleValue);
+        encodingBits |= (uint64_t)pAlphabetEncoding[*(pInVal++)] << nEncodingBits;
+        nEncodingBits += width;
+        if (nEncodingBits >= 8)
+        {
+            outVals[nextOutVal++] = (unsigned char)encodingBits;
+            encodingBits >>= 8;
+            nEncodingBits -= 8;
+        }
     }
+    if (nEncodingBits)
+        outVals[nextOutVal] = (unsigned char)encodingBits; // output last partial byte
+    return (int32_t)nBits;
+} // end encodeFixedAlphabet
 
-    // process fixed bit coding
+// -----------------------------------------------------------------------------------
+static inline int32_t encodeFixedBit(const unsigned char *inVals, unsigned char *outVals, const uint32_t nValues, const uint32_t nUniqueVals, const uint32_t *uniqueOccurrence)
+// -----------------------------------------------------------------------------------
+{
+    // uniques are in outVals[1] to outVals[nUniqueVals] and uniqueOccurrence has the index of each
     uint32_t i;
     uint32_t nextOut;
     uint32_t encodingByte;
@@ -1019,6 +1289,11 @@ static inline int32_t fbc264(unsigned char *inVals, unsigned char *outVals, cons
         {
             if (nUniqueVals > MAX_UNIQUES)
                 return -5; // unexpected program error
+            // nibble mode saves the uniques when values have no more than two high nibbles
+            const int32_t nBitsFixed=(int32_t)(((nValues-1) * 4) + 8 + (nUniqueVals * 8));
+            int32_t nBitsNibble;
+            if ((nBitsNibble = encodeNibbleMode(inVals, outVals, nValues, (uint32_t)nBitsFixed)) > 0)
+                return nBitsNibble;
             // cases 9 through 16 take 4 bits to encode
             // skipping last 3 bits in first byte to be on even byte boundary
             outVals[0] = (unsigned char)((nUniqueVals-1) << 1);
@@ -1049,123 +1324,376 @@ static inline int32_t fbc264(unsigned char *inVals, unsigned char *outVals, cons
                     break;
                 }
             }
-            return (int)(((nValues-1) * 4) + 8 + (nUniqueVals * 8)); // four bits for each value plus 8 indicator bits + 9 to 16 uniques
+            return nBitsFixed; // four bits for each value plus 8 indicator bits + 9 to 16 uniques
         }
     }
     return -6; // unexpected program error
-} // end fbc264
+} // end encodeFixedBit
 
 // -----------------------------------------------------------------------------------
-static inline int32_t decodeTextMode(const unsigned char *inVals, unsigned char *outVals, const uint32_t nOriginalValues, uint32_t *bytesProcessed)
+static inline int32_t encodeControlModeLarge(const unsigned char *inVals, unsigned char *outVals, const uint32_t nValues, const int32_t singleValue)
 // -----------------------------------------------------------------------------------
 {
-    uint32_t nextInVal=(nOriginalValues-1)/8+2;
-    uint32_t nextOutVal=0;
-    uint64_t controlByte=0;
-    uint64_t controlBit=1;
-    uint32_t predefinedTCs=0;
-    uint32_t predefinedTCnt=1; // 1 = first 4-bit PTC is encoded for output, otherwise no
-
-    // read in control bits starting from second byte
-    switch (nextInVal-1)
-    {
-        case 1:
-            controlByte = inVals[1];
-            break;
-        case 2:
-            controlByte = inVals[1];
-            controlByte |= (uint64_t)inVals[2]<<8;
-            break;
-        case 3:
-            controlByte = inVals[1];
-            controlByte |= (uint64_t)inVals[2]<<8;
-            controlByte |= (uint64_t)inVals[3]<<16;
-            break;
-        case 4:
-            controlByte = inVals[1];
-            controlByte |= (uint64_t)inVals[2]<<8;
-            controlByte |= (uint64_t)inVals[3]<<16;
-            controlByte |= (uint64_t)inVals[4]<<24;
-            break;
-        case 5:
-            controlByte = inVals[1];
-            controlByte |= (uint64_t)inVals[2]<<8;
-            controlByte |= (uint64_t)inVals[3]<<16;
-            controlByte |= (uint64_t)inVals[4]<<24;
-            controlByte |= (uint64_t)inVals[5]<<32;
-            break;
-        case 6:
-            controlByte = inVals[1];
-            controlByte |= (uint64_t)inVals[2]<<8;
-            controlByte |= (uint64_t)inVals[3]<<16;
-            controlByte |= (uint64_t)inVals[4]<<24;
-            controlByte |= (uint64_t)inVals[5]<<32;
-            controlByte |= (uint64_t)inVals[6]<<40;
-            break;
-        case 7:
-            controlByte = inVals[1];
-            controlByte |= (uint64_t)inVals[2]<<8;
-            controlByte |= (uint64_t)inVals[3]<<16;
-            controlByte |= (uint64_t)inVals[4]<<24;
-            controlByte |= (uint64_t)inVals[5]<<32;
-            controlByte |= (uint64_t)inVals[6]<<40;
-            controlByte |= (uint64_t)inVals[7]<<48;
-            break;
-        case 8:
-            controlByte = inVals[1];
-            controlByte |= (uint64_t)inVals[2]<<8;
-            controlByte |= (uint64_t)inVals[3]<<16;
-            controlByte |= (uint64_t)inVals[4]<<24;
-            controlByte |= (uint64_t)inVals[5]<<32;
-            controlByte |= (uint64_t)inVals[6]<<40;
-            controlByte |= (uint64_t)inVals[7]<<48;
-            controlByte |= (uint64_t)inVals[8]<<56;
-            break;
-    }
-    while (nextOutVal < nOriginalValues)
+    // text mode if singleValue is negative, otherwise single value mode, for 65 to 256 values
+    // the control bits are kept in up to 4 64-bit words and output from the second byte
+    // text mode: control bit 1 for an 8-bit value, pairs of text chars share one index byte
+    // single value mode: control bit 1 for the single value, stored after the control bytes
+    uint64_t controlWords[MAX_FBC_LARGE_BYTES/64]={0, 0, 0, 0};
+    const uint32_t nControlBytes=(nValues-1)/8+1;
+    uint32_t nextOutVal=nControlBytes+1;
+    uint32_t pairOut=0; // position of index byte with one text char, 0 if none
+    if (singleValue < 0)
     {
-        if (controlByte & controlBit)
-        {
-            // read in and output next 8-bit value
-            outVals[nextOutVal++] = inVals[nextInVal++];
-        }
-        else
+        outVals[0] = 0; // indicate text mode
+        for (uint32_t i=0; i<nValues; i++)
         {
-            // use predefined text chars based on 4-bit index
-            if (predefinedTCnt == 1)
+            const uint32_t inVal=inVals[i];
+            const uint32_t textIndex=textEncoding[inVal];
+            if (textIndex >= 16)
             {
-                predefinedTCs = inVals[nextInVal++];
-                outVals[nextOutVal++] = (unsigned char)textChars[(unsigned char)predefinedTCs & 15];
-                predefinedTCnt = 0;
+                controlWords[i/64] |= (uint64_t)1 << (i%64);
+                outVals[nextOutVal++] = (unsigned char)inVal;
+            }
+            else if (pairOut == 0)
+            {
+                pairOut = nextOutVal++;
+                outVals[pairOut] = (unsigned char)textIndex;
             }
             else
             {
-                outVals[nextOutVal++] = (unsigned char)textChars[predefinedTCs >> 4];
-                predefinedTCnt++;
+                outVals[pairOut] |= (unsigned char)(textIndex << 4);
+                pairOut = 0;
             }
         }
-        controlBit <<= 1;
     }
-    *bytesProcessed = nextInVal;
-    return (int32_t)nOriginalValues;
-} // end decodeTextMode
+    else
+    {
+        outVals[0] = 0x20; // indicate single value mode
+        outVals[nextOutVal++] = (unsigned char)singleValue;
+        for (uint32_t i=0; i<nValues; i++)
+        {
+            const uint32_t inVal=inVals[i];
+            if (inVal == (uint32_t)singleValue)
+                controlWords[i/64] |= (uint64_t)1 << (i%64);
+            else
+                outVals[nextOutVal++] = (unsigned char)inVal;
+        }
+    }
+    for (uint32_t i=0; i<nControlBytes; i++)
+        outVals[i+1] = (unsigned char)(controlWords[i/8] >> ((i%8) * 8));
+    return (int32_t)nextOutVal * 8;
+} // end encodeControlModeLarge
 
 // -----------------------------------------------------------------------------------
-static inline int32_t decodeSingleValueMode(const unsigned char *inVals, unsigned char *outVals, const uint32_t nOriginalValues, uint32_t *bytesProcessed)
+static inline int32_t fbc264large(const unsigned char *inVals, unsigned char *outVals, const uint32_t nValues)
 // -----------------------------------------------------------------------------------
 {
-    uint32_t nextInVal=(nOriginalValues-1)/8+2;
-    uint32_t nextOutVal=0;
-    uint64_t controlByte=0;
-    uint64_t controlBit=1;
-    unsigned char singleValue;
-
-    // read in control bits starting from second byte
-    switch (nextInVal-1)
+    // compress 65 to 256 values in the mode with the smallest output, called by fbc264
+    // the first byte selects the mode as for 64 or fewer values, with longer control bits
+    // for text and single value modes and longer value bits for the other modes
+    uint16_t val256[256];
+    uint32_t uniqueOccurrence[256];
+    uint32_t nUniqueVals=0;
+    uint32_t highBitCheck=0;
+    uint32_t highNibbleBits=0; // a one for each high nibble encountered
+    uint32_t nTextChars=0;
+    uint32_t minVal=inVals[0];
+    uint32_t maxVal=inVals[0];
+    uint32_t singleValue=inVals[0];
+    memset(val256, 0, sizeof(val256));
+    for (uint32_t i=0; i<nValues; i++)
     {
-        case 1:
-            controlByte = inVals[1];
-            break;
+        const uint32_t inVal=inVals[i];
+        highBitCheck |= inVal;
+        highNibbleBits |= 1 << (inVal >> 4);
+        nTextChars += (textEncoding[inVal] < 16);
+        if (inVal < minVal)
+            minVal = inVal;
+        else if (inVal > maxVal)
+            maxVal = inVal;
+        if (val256[inVal]++ == 0)
+        {
+            uniqueOccurrence[inVal] = nUniqueVals++;
+            if (nUniqueVals <= MAX_UNIQUES)
+                outVals[nUniqueVals] = (unsigned char)inVal; // store unique starting at second byte
+        }
+        else if (val256[inVal] > val256[singleValue])
+            singleValue = inVal;
+    }
+
+    // sizes in bits of each mode
+    const uint32_t nControlBytes=(nValues - 1) / 8 + 1;
+    uint32_t bestMode=FBC_MODE_NONE;
+    uint32_t bestBits=nValues * 8;
+    uint32_t nBits=nValues * 8;
+    if (nUniqueVals == 1)
+        nBits = (inVals[0] < 64) ? 8 : 10;
+    else if (nUniqueVals == 2)
+        nBits = nValues - 1 + 21;
+    else if (nUniqueVals <= 4)
+        nBits = (nValues - 1) * 2 + 6 + nUniqueVals * 8;
+    else if (nUniqueVals <= 8)
+        nBits = (nValues - 1) * 3 + 5 + nUniqueVals * 8;
+    else if (nUniqueVals <= MAX_UNIQUES)
+        nBits = (nValues - 1) * 4 + 8 + nUniqueVals * 8;
+    if (nBits < bestBits)
+    {
+        if (nUniqueVals <= 2)
+            return encodeFixedBit(inVals, outVals, nValues, nUniqueVals, uniqueOccurrence); // no mode is smaller
+        bestMode = FBC_MODE_FIXED_BIT;
+        bestBits = nBits;
+    }
+    nBits = (1 + nControlBytes + nValues - nTextChars + (nTextChars + 1) / 2) * 8;
+    if (nBits < bestBits)
+    {
+        bestMode = FBC_MODE_TEXT;
+        bestBits = nBits;
+    }
+    nBits = (1 + nControlBytes + 1 + nValues - val256[singleValue]) * 8;
+    if (nBits < bestBits)
+    {
+        bestMode = FBC_MODE_SINGLE_VALUE;
+        bestBits = nBits;
+    }
+    nBits = (1 + (nValues / 8) * 7 + nValues % 8) * 8;
+    if (((highBitCheck & 0x80) == 0) && (nBits < bestBits))
+    {
+        bestMode = FBC_MODE_7BIT;
+        bestBits = nBits;
+    }
+    if (maxVal - minVal <= 127)
+    {
+        uint32_t width=1;
+        while ((maxVal - minVal) >> width)
+            width++;
+        nBits = 19 + nValues * width;
+        if ((nBits + 7) / 8 < (bestBits + 7) / 8)
+        {
+            bestMode = FBC_MODE_FRAME_OF_REFERENCE;
+            bestBits = nBits;
+        }
+    }
+
+    // nibble mode writes output only when smaller than the best mode, fixed alphabet mode
+    // when smaller than the input; nibble mode, hex chars included, needs at most two high
+    // nibbles and fixed alphabet mode needs ASCII
+    int32_t nBitsEncoded;
+    const uint32_t otherHighNibbleBits=highNibbleBits & (highNibbleBits - 1); // clear lowest high nibble
+    if ((otherHighNibbleBits & (otherHighNibbleBits - 1)) == 0)
+    {
+        if ((nBitsEncoded = encodeNibbleMode(inVals, outVals, nValues, bestBits)) > 0)
+            return nBitsEncoded;
+    }
+    if ((highBitCheck & 0x80) == 0)
+    {
+        unsigned char compressedVals[MAX_FBC_LARGE_BYTES];
+        nBitsEncoded = encodeFixedAlphabet(inVals, compressedVals, nValues);
+        if ((nBitsEncoded > 0) && (((uint32_t)nBitsEncoded + 7) / 8 < (bestBits + 7) / 8))
+        {
+            memcpy(outVals, compressedVals, ((uint32_t)nBitsEncoded + 7) / 8);
+            return nBitsEncoded;
+        }
+    }
+    switch (bestMode)
+    {
+        case FBC_MODE_FIXED_BIT:
+            return encodeFixedBit(inVals, outVals, nValues, nUniqueVals, uniqueOccurrence);
+        case FBC_MODE_TEXT:
+            return encodeControlModeLarge(inVals, outVals, nValues, -1);
+        case FBC_MODE_SINGLE_VALUE:
+            return encodeControlModeLarge(inVals, outVals, nValues, (int32_t)singleValue);
+        case FBC_MODE_7BIT:
+            return encode7bits(inVals, outVals, nValues);
+        case FBC_MODE_FRAME_OF_REFERENCE:
+            return encodeFrameOfReference(inVals, outVals, nValues);
+        default:
+            return 0; // no mode compresses
+    }
+} // end fbc264large
+
+// -----------------------------------------------------------------------------------
+static inline int32_t fbc264(const unsigned char *inVals, unsigned char *outVals, const uint32_t nValues)
+// -----------------------------------------------------------------------------------
+// fbc264: Compress nValues bytes. Return 0 if not compressible (no output bytes),
+//    -1 if error; otherwise, number of bits written to outVals.
+//    Management of whether compressible and number of input values must be maintained
+//    by caller. Decdode requires number of input values and only accepts compressed data.
+// Arguments:
+//   inVals   input byte values
+//   outVals  output byte values if compressed, max of inVals bytes
+//   nValues  number of input byte values, 2 to 256; 65 to 256 values are large blocks
+//            output in the smallest mode by fbc264large
+// Returns number of bits compressed, 0 if not compressed, or -1 if error
+{
+    if (nValues <= 5)
+        return fbc25(inVals, outVals, nValues);
+    
+    if (nValues > MAX_FBC_BYTES)
+    {
+        if (nValues > MAX_FBC_LARGE_BYTES)
+            return -1; // only values 2 to 256 supported
+        return fbc264large(inVals, outVals, nValues);
+    }
+    
+    const unsigned char *pInVal;
+    uint32_t highBitCheck=0;
+    uint32_t predefinedTextCharCnt=0; // count of text chars encountered
+    uint32_t uniqueOccurrence[256]; // order of occurrence of uniques
+    uint32_t nUniqueVals=0; // count of unique vals encountered
+    unsigned char val256[256];
+    const uint32_t uniqueLimit=uniqueLimits25[nValues]; // if exceeded, return uncompressible by fixed bit coding
+    memset(val256, 0, sizeof(val256));
+    const uint32_t nValsInitLoop=(nValues*5/16)+1;
+    const unsigned char *pLastInValPlusOne=inVals+nValues;
+    const unsigned char *pLimitInVals=inVals+nValsInitLoop; // fewest values to test for text mode
+
+    // process enough input vals to eliminate most random data and to check for text mode
+    // for fixed bit coding find and output the uniques starting at outVal[1]
+    //    and saving the unique occurrence value to be used when values are output
+    // for 7 bit mode OR every value
+    // for text mode count number of text characters
+    // for single value mode accumulate frequency counts
+    pInVal = inVals;
+    while (pInVal < pLimitInVals)
+    {
+        uint32_t inVal=*(pInVal++);
+        highBitCheck |= inVal;
+        predefinedTextCharCnt += predefinedTextChars[inVal]; // count text chars for text char mode
+        if (val256[inVal]++ == 0)
+        {
+            // first occurrence of value, for fixed bit coding:
+            uniqueOccurrence[inVal] = nUniqueVals; // save occurrence count for this unique
+            outVals[++nUniqueVals] = (unsigned char)inVal; // store unique starting at second byte
+        }
+    }
+    if (nUniqueVals > uniqueLimit)
+    {
+        // supported unique values exceeded
+        // attempt to compress based on high nibbles, a fixed alphabet or a narrow range of values
+        int32_t nBitsFOR;
+        if ((nBitsFOR = encodeNibbleMode(inVals, outVals, nValues, nValues * 8)) > 0)
+            return nBitsFOR;
+        if ((nBitsFOR = encodeFixedAlphabet(inVals, outVals, nValues)) > 0)
+            return nBitsFOR;
+        if ((nBitsFOR = encodeFrameOfReference(inVals, outVals, nValues)) > 0)
+            return nBitsFOR;
+        if ((highBitCheck & 0x80) == 0)
+        {
+            // attempt to compress based on high bit clear across all values
+            // confirm remaining values have high bit clear
+            while (pInVal < pLastInValPlusOne)
+                highBitCheck |= *pInVal++;
+            if (((highBitCheck & 0x80) == 0) && (nValues >= 16))
+                return encode7bits(inVals, outVals, nValues); // saves a byte for each 8 values less the first byte
+        }
+        return 0; // too many uniques to compress with fixed bit coding, random data fails here
+    }
+    if (nUniqueVals > uniqueLimits25[nValsInitLoop] * 3/4 + 1)
+    {
+        // make sure at least 3/4 of uniques for the initial number of values is exceeded
+        //    because fixed bit coding will produce higher compression
+        // check text mode validity as it's not considered after this
+        // text mode will have 3/4 text values, but for smaller numbers, use .5
+        // this number of values will almost always compress, though 1/4 of data must be text
+        // chars to compress; encodeTextMode verifies compression occurs
+        if (predefinedTextCharCnt > nValsInitLoop / 2)
+        {
+            // hex, base32 and base64 chars are also text chars; nibble and fixed alphabet modes
+            // fail within a few values of other text, and take precedence when smaller
+            int32_t nBitsText;
+            if ((nBitsText = encodeNibbleMode(inVals, outVals, nValues, nValues * 8)) > 0)
+                return nBitsText;
+            unsigned char alphabetVals[MAX_FBC_BYTES*2];
+            const int32_t nBitsAlphabet=encodeFixedAlphabet(inVals, alphabetVals, nValues);
+            // compress in text mode
+            nBitsText = encodeTextMode(inVals, outVals, nValues);
+            if ((nBitsAlphabet > 0) && ((nBitsText <= 0) || (nBitsAlphabet < nBitsText)))
+            {
+                memcpy(outVals, alphabetVals, (nBitsAlphabet + 7) / 8);
+                return nBitsAlphabet;
+            }
+            return nBitsText;
+        }
+    }
+    // continue fixed bit loop with checks for high bit set and repeat counts
+    // look for minimum count to validate single value mode
+    const uint32_t singleValueOverFixexBitRepeats=nValsInitLoop*3/2;
+    const uint32_t minRepeatsSingleValueMode=(unsigned char)nValues/4+1;
+    int32_t singleValue=-1; // look for value that repeats MIN_REPEATS_SINGLE_VALUE_MODE
+    while (pInVal < pLastInValPlusOne)
+    {
+        uint32_t inVal=*(pInVal++);
+        highBitCheck |= inVal;
+        if (val256[inVal]++ == 0)
+        {
+            // first occurrence of value, for fixed bit coding:
+            uniqueOccurrence[inVal] = nUniqueVals; // save occurrence count for this unique
+            outVals[++nUniqueVals] = (unsigned char)inVal; // store unique starting at second byte
+        }
+        else if (val256[inVal] >= minRepeatsSingleValueMode)
+        {
+            singleValue = (int32_t)inVal;
+            break; // continue loop without further checking
+        }
+    }
+    // continue fixed bit loop with checks for high bit set and repeat counts
+    while (pInVal < pLastInValPlusOne)
+    {
+        uint32_t inVal=*(pInVal++);
+        highBitCheck |= inVal;
+        if (val256[inVal]++ == 0)
+        {
+            // first occurrence of value, for fixed bit coding:
+            uniqueOccurrence[inVal] = nUniqueVals; // save occurrence count for this unique
+            outVals[++nUniqueVals] = (unsigned char)inVal; // store unique starting at second byte
+        }
+    }
+    if (nUniqueVals > uniqueLimit)
+    {
+        // fixed bit coding fails, try for other compression modes
+        // single value mode outputs the first byte, control bits, single value and other values
+        if ((singleValue >= 0) && (val256[singleValue] > (nValues - 1) / 8 + 3))
+        {
+            return encodeSingleValueMode(inVals, outVals, nValues, singleValue);
+        }
+        int32_t nBitsFOR;
+        if ((nBitsFOR = encodeNibbleMode(inVals, outVals, nValues, nValues * 8)) > 0)
+            return nBitsFOR;
+        if ((nBitsFOR = encodeFixedAlphabet(inVals, outVals, nValues)) > 0)
+            return nBitsFOR;
+        if ((nBitsFOR = encodeFrameOfReference(inVals, outVals, nValues)) > 0)
+            return nBitsFOR;
+        if (((highBitCheck & 0x80) == 0) && (nValues >= 16))
+            return encode7bits(inVals, outVals, nValues);
+        return 0; // too many uniques to compress
+    }
+    else if ((nUniqueVals > 8) && (singleValue >= 0) && (val256[singleValue] >= singleValueOverFixexBitRepeats) &&
+             (val256[singleValue] > (nValues - 1) / 8 + 3))
+    {
+        // favor single value over 12 value fixed 4-bit encoding
+        return encodeSingleValueMode(inVals, outVals, nValues, singleValue);
+    }
+
+    return encodeFixedBit(inVals, outVals, nValues, nUniqueVals, uniqueOccurrence);
+} // end fbc264
+
+// -----------------------------------------------------------------------------------
+static inline int32_t decodeTextMode(const unsigned char *inVals, unsigned char *outVals, const uint32_t nOriginalValues, uint32_t *bytesProcessed)
+// -----------------------------------------------------------------------------------
+{
+    uint32_t nextInVal=(nOriginalValues-1)/8+2;
+    uint32_t nextOutVal=0;
+    uint64_t controlByte=0;
+    uint64_t controlBit=1;
+    uint32_t predefinedTCs=0;
+    uint32_t predefinedTCnt=1; // 1 = first 4-bit PTC is encoded for output, otherwise no
+
+    // read in control bits starting from second byte
+    switch (nextInVal-1)
+    {
+        case 1:
+            controlByte = inVals[1];
+            break;
         case 2:
             controlByte = inVals[1];
             controlByte |= (uint64_t)inVals[2]<<8;
@@ -1216,18 +1744,27 @@ static inline int32_t decodeSingleValueMode(const unsigned char *inVals, unsigne
             controlByte |= (uint64_t)inVals[8]<<56;
             break;
     }
-    singleValue = inVals[nextInVal++]; // single value output when control bit is 1
     while (nextOutVal < nOriginalValues)
     {
         if (controlByte & controlBit)
         {
-            // output single value
-            outVals[nextOutVal++] = singleValue;
+            // read in and output next 8-bit value
+            outVals[nextOutVal++] = inVals[nextInVal++];
         }
         else
         {
-            // output next value from input
-            outVals[nextOutVal++] = inVals[nextInVal++];
+            // use predefined text chars based on 4-bit index
+            if (predefinedTCnt == 1)
+            {
+                predefinedTCs = inVals[nextInVal++];
+                outVals[nextOutVal++] = (unsigned char)textChars[(unsigned char)predefinedTCs & 15];
+                predefinedTCnt = 0;
+            }
+            else
+            {
+                outVals[nextOutVal++] = (unsigned char)textChars[predefinedTCs >> 4];
+                predefinedTCnt++;
+            }
         }
         controlBit <<= 1;
     }
@@ -1235,67 +1772,297 @@ static inline int32_t decodeSingleValueMode(const unsigned char *inVals, unsigne
     return (int32_t)nOriginalValues;
 } // end decodeTextMode
 
-static inline int32_t decode7bits(const unsigned char *inVals, unsigned char *outVals, const uint32_t nOriginalValues, uint32_t *bytesProcessed)
+// -----------------------------------------------------------------------------------
+static inline int32_t decodeSingleValueMode(const unsigned char *inVals, unsigned char *outVals, const uint32_t nOriginalValues, uint32_t *bytesProcessed)
+// -----------------------------------------------------------------------------------
 {
+    uint32_t nextInVal=(nOriginalValues-1)/8+2;
     uint32_t nextOutVal=0;
-    uint32_t nextInVal=1;
-    uint32_t val1;
-    uint32_t val2;
-    
-    // process groups of 8 bytes to output 7 bytes
-    while (nextOutVal + 7 < nOriginalValues)
-    {
-        // move groups of 7-bit vals into 8 bytes
-        val1 = inVals[nextInVal++];
-        outVals[nextOutVal++] = (unsigned char)(val1 & 127);
-        val2 = inVals[nextInVal++];
-        outVals[nextOutVal++] = (unsigned char)(((val2 << 1) & 127) | (val1 >> 7));
-        val1 = inVals[nextInVal++];
-        outVals[nextOutVal++] = (unsigned char)(((val1 << 2) & 127) | (val2 >> 6));
-        val2 = inVals[nextInVal++];
-        outVals[nextOutVal++] = (unsigned char)(((val2 << 3) & 127) | (val1 >> 5));
-        val1 = inVals[nextInVal++];
-        outVals[nextOutVal++] = (unsigned char)(((val1 << 4) & 127) | (val2 >> 4));
-        val2 = inVals[nextInVal++];
-        outVals[nextOutVal++] = (unsigned char)(((val2 << 5) & 127) | (val1 >> 3));
-        val1 = inVals[nextInVal++];
-        outVals[nextOutVal++] = (unsigned char)(((val1 << 6) & 127) | (val2 >> 2));
-        outVals[nextOutVal++] = (unsigned char)val1 >> 1;
-    }
-    while (nextOutVal++ < nOriginalValues)
+    uint64_t controlByte=0;
+    unsigned char singleValue;
+
+    // read in control bits starting from second byte
+    switch (nextInVal-1)
     {
-        // output final values as full bytes because no bytes saved, only bits
-        outVals[nextOutVal++] = inVals[nextInVal++];
-        if (nextOutVal == nOriginalValues)
+        case 1:
+            controlByte = inVals[1];
             break;
-        outVals[nextOutVal++] = inVals[nextInVal++];
-        if (nextOutVal == nOriginalValues)
+        case 2:
+            controlByte = inVals[1];
+            controlByte |= (uint64_t)inVals[2]<<8;
             break;
-        outVals[nextOutVal++] = inVals[nextInVal++];
-        if (nextOutVal == nOriginalValues)
+        case 3:
+            controlByte = inVals[1];
+            controlByte |= (uint64_t)inVals[2]<<8;
+            controlByte |= (uint64_t)inVals[3]<<16;
             break;
-        outVals[nextOutVal++] = inVals[nextInVal++];
-        if (nextOutVal == nOriginalValues)
+        case 4:
+            controlByte = inVals[1];
+            controlByte |= (uint64_t)inVals[2]<<8;
+            controlByte |= (uint64_t)inVals[3]<<16;
+            controlByte |= (uint64_t)inVals[4]<<24;
             break;
-        outVals[nextOutVal++] = inVals[nextInVal++];
-        if (nextOutVal == nOriginalValues)
+        case 5:
+            controlByte = inVals[1];
+            controlByte |= (uint64_t)inVals[2]<<8;
+            controlByte |= (uint64_t)inVals[3]<<16;
+            controlByte |= (uint64_t)inVals[4]<<24;
+            controlByte |= (uint64_t)inVals[5]<<32;
             break;
-        outVals[nextOutVal++] = inVals[nextInVal++];
-        if (nextOutVal == nOriginalValues)
+        case 6:
+            controlByte = inVals[1];
+            controlByte |= (uint64_t)inVals[2]<<8;
+            controlByte |= (uint64_t)inVals[3]<<16;
+            controlByte |= (uint64_t)inVals[4]<<24;
+            controlByte |= (uint64_t)inVals[5]<<32;
+            controlByte |= (uint64_t)inVals[6]<<40;
             break;
-        outVals[nextOutVal++] = inVals[nextInVal++];
+        case 7:
+            controlByte = inVals[1];
+            controlByte |= (uint64_t)inVals[2]<<8;
+            controlByte |= (uint64_t)inVals[3]<<16;
+            controlByte |= (uint64_t)inVals[4]<<24;
+            controlByte |= (uint64_t)inVals[5]<<32;
+            controlByte |= (uint64_t)inVals[6]<<40;
+            controlByte |= (uint64_t)inVals[7]<<48;
             break;
+        case 8:
+            controlByte = inVals[1];
+            controlByte |= (uint64_t)inVals[2]<<8;
+            controlByte |= (uint64_t)inVals[3]<<16;
+            controlByte |= (uint64_t)inVals[4]<<24;
+            controlByte |= (uint64_t)inVals[5]<<32;
+            controlByte |= (uint64_t)inVals[6]<<40;
+            controlByte |= (uint64_t)inVals[7]<<48;
+            controlByte |= (uint64_t)inVals[8]<<56;
+            break;
+    }
+    singleValue = inVals[nextInVal++]; // single value output when control bit is 1
+    // without branches on the control bits: the byte read for the single value is the one
+    //    before the next input value, which is never past the block
+    while (nextOutVal < nOriginalValues)
+    {
+        const uint32_t isSingleValue=(uint32_t)(controlByte >> nextOutVal) & 1;
+        const uint32_t singleValueMask=0u - isSingleValue;
+        const uint32_t inVal=inVals[nextInVal - isSingleValue];
+        outVals[nextOutVal++] = (unsigned char)((singleValue & singleValueMask) | (inVal & ~singleValueMask));
+        nextInVal += isSingleValue ^ 1;
+    }
+    *bytesProcessed = nextInVal;
+    return (int32_t)nOriginalValues;
+} // end decodeTextMode
+
+static inline int32_t decode7bits(const unsigned char *inVals, unsigned char *outVals, const uint32_t nOriginalValues, uint32_t *bytesProcessed)
+{
+    uint32_t nextOutVal=0;
+    uint32_t nextInVal=1;
+    uint32_t val1;
+    uint32_t val2;
+    
+    // process groups of 8 bytes to output 7 bytes
+    while (nextOutVal + 7 < nOriginalValues)
+    {
+        // move groups of 7-bit vals into 8 bytes
+        val1 = inVals[nextInVal++];
+        outVals[nextOutVal++] = (unsigned char)(val1 & 127);
+        val2 = inVals[nextInVal++];
+        outVals[nextOutVal++] = (unsigned char)(((val2 << 1) & 127) | (val1 >> 7));
+        val1 = inVals[nextInVal++];
+        outVals[nextOutVal++] = (unsigned char)(((val1 << 2) & 127) | (val2 >> 6));
+        val2 = inVals[nextInVal++];
+        outVals[nextOutVal++] = (unsigned char)(((val2 << 3) & 127) | (val1 >> 5));
+        val1 = inVals[nextInVal++];
+        outVals[nextOutVal++] = (unsigned char)(((val1 << 4) & 127) | (val2 >> 4));
+        val2 = inVals[nextInVal++];
+        outVals[nextOutVal++] = (unsigned char)(((val2 << 5) & 127) | (val1 >> 3));
+        val1 = inVals[nextInVal++];
+        outVals[nextOutVal++] = (unsigned char)(((val1 << 6) & 127) | (val2 >> 2));
+        outVals[nextOutVal++] = (unsigned char)val1 >> 1;
     }
+    // final 0 to 7 values were output as full bytes
+    memcpy(outVals+nextOutVal, inVals+nextInVal, nOriginalValues-nextOutVal);
+    nextInVal += nOriginalValues - nextOutVal;
     *bytesProcessed = nextInVal;
     return (int32_t)nOriginalValues;
 } // end decode7bits
 
+// -----------------------------------------------------------------------------------
+static inline int32_t decodeFrameOfReference(const unsigned char *inVals, unsigned char *outVals, const uint32_t nOriginalValues, uint32_t *bytesProcessed)
+// -----------------------------------------------------------------------------------
+{
+    const uint32_t minVal=inVals[1];
+    uint64_t encodingBits=inVals[2];
+    const uint32_t width=(uint32_t)(encodingBits & 7) + 1;
+    const uint64_t valueMask=(1 << width) - 1;
+    uint32_t nEncodingBits=5; // bits remaining after width
+    uint32_t nextInVal=3;
+    uint32_t nextOutVal=0;
+    
+    encodingBits >>= 3;
+    while (nextOutVal < nOriginalValues)
+    {
+        if (nEncodingBits < width)
+        {
+            encodingBits |= (uint64_t)inVals[nextInVal++] << nEncodingBits;
+            nEncodingBits += 8;
+        }
+        outVals[nextOutVal++] = (unsigned char)(minVal + (encodingBits & valueMask));
+        encodingBits >>= width;
+        nEncodingBits -= width;
+    }
+    *bytesProcessed = nextInVal;
+    return (int32_t)nOriginalValues;
+} // end decodeFrameOfReference
+
+// -----------------------------------------------------------------------------------
+static inline int32_t decodeNibbleMode(const unsigned char *inVals, unsigned char *outVals, const uint32_t nOriginalValues, uint32_t *bytesProcessed)
+// -----------------------------------------------------------------------------------
+{
+    const uint32_t highNibbles[2]={(uint32_t)(inVals[1] & 0xf) << 4, (uint32_t)inVals[1] & 0xf0};
+    uint32_t nextInVal=2;
+    uint32_t nextOutVal=0;
+    uint32_t inByte;
+    
+    if (highNibbles[0] == highNibbles[1])
+    {
+        // 4-bit low nibbles with single high nibble
+        const uint32_t highNibble=highNibbles[0];
+        while (nextOutVal + 1 < nOriginalValues)
+        {
+            inByte = inVals[nextInVal++];
+            outVals[nextOutVal++] = (unsigned char)(highNibble | (inByte & 0xf));
+            outVals[nextOutVal++] = (unsigned char)(highNibble | (inByte >> 4));
+        }
+        if (nextOutVal < nOriginalValues)
+            outVals[nextOutVal++] = (unsigned char)(highNibble | (inVals[nextInVal++] & 0xf));
+        *bytesProcessed = nextInVal;
+        return (int32_t)nOriginalValues;
+    }
+    // 5-bit values: selector bit for high nibble above 4-bit low nibble
+    uint64_t encodingBits=0;
+    uint32_t nEncodingBits=0;
+    while (nextOutVal < nOriginalValues)
+    {
+        if (nEncodingBits < 5)
+        {
+            encodingBits |= (uint64_t)inVals[nextInVal++] << nEncodingBits;
+            nEncodingBits += 8;
+        }
+        outVals[nextOutVal++] = (unsigned char)(highNibbles[(encodingBits >> 4) & 1] | (encodingBits & 0xf));
+        encodingBits >>= 5;
+        nEncodingBits -= 5;
+    }
+    *bytesProcessed = nextInVal;
+    return (int32_t)nOriginalValues;
+} // end decodeNibbleMode
+
+// -----------------------------------------------------------------------------------
+static inline int32_t decodeFixedAlphabet(const unsigned char *inVals, unsigned char *outVals, const uint32_t nOriginalValues, uint32_t *bytesProcessed)
+// -----------------------------------------------------------------------------------
+{
+    const uint32_t alphabet=inVals[1] & 0xf;
+    const uint32_t nPadChars=inVals[1] >> 4;
+    uint32_t nextInVal=2;
+    uint32_t nextOutVal=0;
+    uint32_t inByte;
+    
+    if ((alphabet == BASE64_ALPHABET) || (alphabet == BASE32_ALPHABET))
+    {
+        // 6-bit index to base64 chars or 5-bit index to base32 chars, then '=' padding chars
+        if (nPadChars >= nOriginalValues)
+            return -10; // unexpected program error
+        const unsigned char *pAlphabetChars=base64Chars;
+        uint32_t width=6;
+        if (alphabet == BASE32_ALPHABET)
+        {
+            pAlphabetChars = base32Chars;
+            width = 5;
+        }
+        const uint64_t valueMask=(1 << width) - 1;
+        uint64_t encodingBits=0;
+        uint32_t nEncodingBits=0;
+        while (nextOutVal < nOriginalValues - nPadChars)
+        {
+            if (nEncodingBits < width)
+            {
+                encodingBits |= (uint64_t)inVals[nextInVal++] << nEncodingBits;
+                nEncodingBits += 8;
+            }
+            outVals[nextOutVal++] = pAlphabetChars[encodingBits & valueMask];
+            encodingBits >>= width;
+            nEncodingBits -= width;
+        }
+        memset(outVals+nextOutVal, '=', nPadChars);
+        *bytesProcessed = nextInVal;
+        return (int32_t)nOriginalValues;
+    }
+    if ((alphabet > HEX_UPPER_ALPHABET) || nPadChars)
+        return -10; // unexpected program error
+    const unsigned char *pAlphabetChars=hexChars[alphabet];
+    while (nextOutVal + 1 < nOriginalValues)
+    {
+        inByte = inVals[nextInVal++];
+        outVals[nextOutVal++] = pAlphabetChars[inByte & 0xf];
+        outVals[nextOutVal++] = pAlphabetChars[inByte >> 4];
+    }
+    if (nextOutVal < nOriginalValues)
+        outVals[nextOutVal++] = pAlphabetChars[inVals[nextInVal++] & 0xf];
+    *bytesProcessed = nextInVal;
+    return (int32_t)nOriginalValues;
+} // end decodeFixedAlphabet
+
+// -----------------------------------------------------------------------------------
+static inline int32_t decodeControlModeLarge(const unsigned char *inVals, unsigned char *outVals, const uint32_t nOriginalValues, uint32_t *bytesProcessed)
+// -----------------------------------------------------------------------------------
+{
+    // decode text mode or single value mode output by encodeControlModeLarge
+    uint64_t controlWords[MAX_FBC_LARGE_BYTES/64]={0, 0, 0, 0};
+    const uint32_t nControlBytes=(nOriginalValues-1)/8+1;
+    uint32_t nextInVal=nControlBytes+1;
+    for (uint32_t i=0; i<nControlBytes; i++)
+        controlWords[i/8] |= (uint64_t)inVals[i+1] << ((i%8) * 8);
+    if (inVals[0] == 0)
+    {
+        // text mode
+        uint32_t predefinedTCs=0x100; // index byte of a pair, 0x100 when next text char reads a new byte
+        for (uint32_t i=0; i<nOriginalValues; i++)
+        {
+            if ((controlWords[i/64] >> (i%64)) & 1)
+                outVals[i] = inVals[nextInVal++];
+            else if (predefinedTCs & 0x100)
+            {
+                predefinedTCs = inVals[nextInVal++];
+                outVals[i] = (unsigned char)textChars[predefinedTCs & 0xf];
+            }
+            else
+            {
+                outVals[i] = (unsigned char)textChars[predefinedTCs >> 4];
+                predefinedTCs = 0x100;
+            }
+        }
+    }
+    else
+    {
+        // single value mode
+        const unsigned char singleValue=inVals[nextInVal++];
+        for (uint32_t i=0; i<nOriginalValues; i++)
+        {
+            if ((controlWords[i/64] >> (i%64)) & 1)
+                outVals[i] = singleValue;
+            else
+                outVals[i] = inVals[nextInVal++];
+        }
+    }
+    *bytesProcessed = nextInVal;
+    return (int32_t)nOriginalValues;
+} // end decodeControlModeLarge
+
 // -----------------------------------------------------------------------------------
 static inline int32_t fbc264d(const unsigned char *inVals, unsigned char *outVals, const uint32_t nOriginalValues, uint32_t *bytesProcessed)
 // -----------------------------------------------------------------------------------
 // fixed bit decoding requires number of original values and encoded bytes
 // uncompressed data is not acceppted
-// 2 to 16 unique values were encoded for 2 to 64 input values.
+// 2 to 16 unique values were encoded for 2 to 64 input values, or large blocks of 65 to 256.
 // 2 to 5 input values are handled separately.
 // inVals   compressed data with fewer bits than in original values
 // outVals  decompressed data
@@ -1305,7 +2072,7 @@ static inline int32_t fbc264d(const unsigned char *inVals, unsigned char *outVal
     if (nOriginalValues <= 5)
         return fbc25d(inVals, outVals, nOriginalValues, bytesProcessed);
     
-    if (nOriginalValues > MAX_FBC_BYTES)
+    if (nOriginalValues > MAX_FBC_LARGE_BYTES)
         return -1;
         
     const unsigned char firstByte=inVals[0];
@@ -1330,18 +2097,38 @@ static inline int32_t fbc264d(const unsigned char *inVals, unsigned char *outVal
     switch (nUniques)
     {
         case 1:
-            if (firstByte & 0x20)
-            {
-                // single value mode
-                return decodeSingleValueMode(inVals, outVals, nOriginalValues, bytesProcessed);
-            }
-            if (firstByte & 0x40)
+            // no uniques: bits 5-7 select the mode
+            switch (firstByte >> 5)
             {
-                // 7-bit mode
-                return decode7bits(inVals, outVals, nOriginalValues, bytesProcessed);
+                case 0:
+                    // text mode using predefined text chars
+                    if (nOriginalValues > MAX_FBC_BYTES)
+                        return decodeControlModeLarge(inVals, outVals, nOriginalValues, bytesProcessed);
+                    return decodeTextMode(inVals, outVals, nOriginalValues, bytesProcessed);
+                case 1:
+                    // single value mode
+                    if (nOriginalValues > MAX_FBC_BYTES)
+                        return decodeControlModeLarge(inVals, outVals, nOriginalValues, bytesProcessed);
+                    return decodeSingleValueMode(inVals, outVals, nOriginalValues, bytesProcessed);
+                case 2:
+                    // 7-bit mode
+                    return decode7bits(inVals, outVals, nOriginalValues, bytesProcessed);
+                case 3:
+                    // frame of reference mode
+                    return decodeFrameOfReference(inVals, outVals, nOriginalValues, bytesProcessed);
+                case 4:
+                    // nibble mode
+                    return decodeNibbleMode(inVals, outVals, nOriginalValues, bytesProcessed);
+                case 5:
+                    // fixed alphabet mode
+                    return decodeFixedAlphabet(inVals, outVals, nOriginalValues, bytesProcessed);
+                case 6:
+                    return -11; // repeat block mode must be decoded by fbc264ddedup
+                case 7:
+                    return -12; // extended mode must be decoded by its stream decoder, such as fbc264dxor
+                default:
+                    return -9; // unexpected program error
             }
-            // 0 in 6th bit: text mode using predefined text chars
-            return decodeTextMode(inVals, outVals, nOriginalValues, bytesProcessed);
         case 2:
         {
             // 1-bit values
@@ -1525,5 +2312,2373 @@ static inline int32_t fbc264d(const unsigned char *inVals, unsigned char *outVal
     return -8; // unexpected program error
 } // end fbc264d
 
-#endif /* fbc_h */
+// -----------------------------------------------------------------------------------
+static inline uint32_t popcount64(uint64_t bits)
+// -----------------------------------------------------------------------------------
+{
+    bits = bits - ((bits >> 1) & 0x5555555555555555);
+    bits = (bits & 0x3333333333333333) + ((bits >> 2) & 0x3333333333333333);
+    bits = (bits + (bits >> 4)) & 0x0f0f0f0f0f0f0f0f;
+    return (uint32_t)((bits * 0x0101010101010101) >> 56);
+} // end popcount64
+
+// -----------------------------------------------------------------------------------
+static inline uint32_t leadingZeros64(uint64_t bits)
+// -----------------------------------------------------------------------------------
+{
+    // smear the highest set bit down, then count the bits above it
+    bits |= bits >> 1;
+    bits |= bits >> 2;
+    bits |= bits >> 4;
+    bits |= bits >> 8;
+    bits |= bits >> 16;
+    bits |= bits >> 32;
+    return popcount64(~bits);
+} // end leadingZeros64
+
+// -----------------------------------------------------------------------------------
+static inline int32_t fbc25size(const unsigned char *inVals, const uint32_t nOriginalValues)
+// -----------------------------------------------------------------------------------
+// Return number of bytes in data compressed by fbc25 without decoding, or -1 if error
+{
+    if (inVals[0] & 1)
+        return (inVals[0] & 2) ? 1 : 2; // single unique
+    switch (nOriginalValues)
+    {
+        case 2:
+        case 3:
+            return 2; // two unique nibbles
+        case 4:
+        case 5:
+            return 3; // two uniques
+        default:
+            return -1;
+    }
+} // end fbc25size
+
+// -----------------------------------------------------------------------------------
+static inline int32_t fbc264size(const unsigned char *inVals, const uint32_t nOriginalValues)
+// -----------------------------------------------------------------------------------
+// Return number of bytes in data compressed by fbc264 without decoding, which is the same
+//    as bytesProcessed returned by fbc264d, for 2 to 256 values including large blocks.
+//    Also returns the size of repeat block and XOR
+//    prediction blocks. Returns negative if error or for unique reuse blocks, which require
+//    the uniques state of the stream.
+{
+    if (nOriginalValues <= 5)
+        return fbc25size(inVals, nOriginalValues);
+    if (nOriginalValues > MAX_FBC_LARGE_BYTES)
+        return -1;
+    const uint32_t firstByte=inVals[0];
+    if (firstByte & 1)
+        return (firstByte & 2) ? 1 : 2; // single unique
+    const uint32_t nUniques=((firstByte >> 1) & 0xf) + 1;
+    const uint32_t n=nOriginalValues;
+    switch (nUniques)
+    {
+        case 1:
+            break; // modes without uniques
+        case 2:
+            return (int32_t)((n - 1 + 21 + 7) / 8);
+        case 3:
+        case 4:
+            return (int32_t)(((n - 1) * 2 + 6 + nUniques * 8 + 7) / 8);
+        case 5:
+        case 6:
+        case 7:
+        case 8:
+            return (int32_t)(((n - 1) * 3 + 5 + nUniques * 8 + 7) / 8);
+        default:
+            return (int32_t)(((n - 1) * 4 + 8 + nUniques * 8 + 7) / 8);
+    }
+    const uint32_t nControlBytes=(n - 1) / 8 + 1;
+    switch (firstByte >> 5)
+    {
+        case 0:
+        case 1:
+        {
+            // text or single value mode: count control bits, in up to 4 64-bit words for large blocks
+            uint32_t nControlOnes=0;
+            for (uint32_t word=0; word*8<nControlBytes; word++)
+            {
+                uint64_t controlBits=0;
+                for (uint32_t i=word*8; (i<word*8+8) && (i<nControlBytes); i++)
+                    controlBits |= (uint64_t)inVals[i+1] << ((i - word*8) * 8);
+                if (n < word*64+64)
+                    controlBits &= ((uint64_t)1 << (n - word*64)) - 1;
+                nControlOnes += popcount64(controlBits);
+            }
+            if (firstByte == 0)
+                return (int32_t)(1 + nControlBytes + nControlOnes + (n - nControlOnes + 1) / 2); // 8-bit values and pairs of text chars
+            return (int32_t)(1 + nControlBytes + 1 + n - nControlOnes); // single value and other values
+        }
+        case 2:
+            return (int32_t)(1 + (n / 8) * 7 + n % 8); // 7-bit mode
+        case 3:
+            return (int32_t)((19 + n * ((inVals[2] & 7) + 1) + 7) / 8); // frame of reference mode
+        case 4:
+            if ((inVals[1] & 0xf) == (inVals[1] >> 4))
+                return (int32_t)(2 + (n + 1) / 2); // nibble mode with single high nibble
+            return (int32_t)((16 + n * 5 + 7) / 8);
+        case 5:
+            if ((inVals[1] >> 4) >= n)
+                return -10;
+            switch (inVals[1] & 0xf)
+            {
+                case HEX_LOWER_ALPHABET:
+                case HEX_UPPER_ALPHABET:
+                    return (int32_t)(2 + (n + 1) / 2);
+                case BASE64_ALPHABET:
+                    return (int32_t)((16 + (n - (inVals[1] >> 4)) * 6 + 7) / 8); // '=' padding chars are not output
+                case BASE32_ALPHABET:
+                    return (int32_t)((16 + (n - (inVals[1] >> 4)) * 5 + 7) / 8);
+                default:
+                    return -10;
+            }
+        case 6:
+            return 3; // repeat block mode
+        default:
+        {
+            if ((inVals[1] & 0xf) != EXTENDED_XOR_MODE)
+                return -12; // size requires stream state
+            const int32_t nBytes=fbc264size(inVals+2, nOriginalValues);
+            return (nBytes < 0) ? nBytes : nBytes + 2;
+        }
+    }
+} // end fbc264size
+
+// repeat block mode state for one stream of blocks, initialize with fbcDedupInit
+struct fbcDedup_s {
+    uint32_t blockNumbers[1 << DEDUP_HASH_BITS]; // most recent block number + 1 for a hash, 0 if none
+    uint16_t nBits[1 << DEDUP_HASH_BITS]; // bits output by fbc264 for that block, 0 if not compressed
+    uint32_t nextBlockNumber; // number of blocks processed
+};
+
+// -----------------------------------------------------------------------------------
+static inline void fbcDedupInit(struct fbcDedup_s *dedup)
+// -----------------------------------------------------------------------------------
+{
+    memset(dedup, 0, sizeof(struct fbcDedup_s));
+} // end fbcDedupInit
+
+// -----------------------------------------------------------------------------------
+static inline uint32_t dedupHash(const unsigned char *inVals, const uint32_t nValues)
+// -----------------------------------------------------------------------------------
+{
+    // 64-bit multiply and xor-shift hash of 8 bytes at a time, return top DEDUP_HASH_BITS bits
+    uint64_t hash=nValues;
+    uint64_t word;
+    uint32_t i=0;
+    while (i + 8 <= nValues)
+    {
+        memcpy(&word, inVals+i, sizeof(word));
+        hash = (hash ^ word) * 0x9e3779b97f4a7c15;
+        hash ^= hash >> 29;
+        i += 8;
+    }
+    while (i < nValues)
+        hash = (hash ^ inVals[i++]) * 0x9e3779b97f4a7c15;
+    return (uint32_t)(hash >> (64 - DEDUP_HASH_BITS));
+} // end dedupHash
+
+// -----------------------------------------------------------------------------------
+static inline int32_t fbc264dedup(struct fbcDedup_s *dedup, const unsigned char *inVals, unsigned char *outVals, const uint32_t nValues)
+// -----------------------------------------------------------------------------------
+// fbc264dedup: Compress nValues bytes as fbc264, or as a repeat of one of the previous
+//    DEDUP_WINDOW_BLOCKS-1 blocks in 3 bytes: 0xc0 followed by the 16-bit block distance.
+//    Every block of a stream must be passed in order with the same nValues from one
+//    contiguous input buffer, as the repeated block is compared at inVals - distance*nValues.
+//    Decode with fbc264ddedup.
+// Arguments:
+//   dedup    stream state initialized by fbcDedupInit
+//   inVals   input byte values
+//   outVals  output byte values if compressed, max of inVals bytes
+//   nValues  number of input byte values, 6 to 64
+// Returns number of bits compressed, 0 if not compressed, or -1 if error
+{
+    if ((nValues <= 5) || (nValues > MAX_FBC_BYTES))
+        return -1; // only values 6 to 64 supported as fbc25 uses all bits of first byte
+    
+    const uint32_t hash=dedupHash(inVals, nValues);
+    const uint32_t blockNumber=dedup->nextBlockNumber++;
+    const uint32_t prevBlockNumber=dedup->blockNumbers[hash];
+    dedup->blockNumbers[hash] = blockNumber + 1;
+    if (prevBlockNumber)
+    {
+        const uint32_t distance=blockNumber + 1 - prevBlockNumber;
+        const uint32_t prevBits=dedup->nBits[hash];
+        if ((distance < DEDUP_WINDOW_BLOCKS) && ((prevBits == 0) || (prevBits > 24)) &&
+            (memcmp(inVals, inVals - distance * nValues, nValues) == 0))
+        {
+            // same block seen within window and not smaller with fbc264
+            outVals[0] = 0xc0; // indicate repeat block mode
+            outVals[1] = (unsigned char)distance;
+            outVals[2] = (unsigned char)(distance >> 8);
+            return 24;
+        }
+    }
+    const int32_t nBits=fbc264(inVals, outVals, nValues);
+    dedup->nBits[hash] = (nBits > 0) ? (uint16_t)nBits : 0;
+    return nBits;
+} // end fbc264dedup
+
+// -----------------------------------------------------------------------------------
+static inline int32_t fbc264ddedup(const unsigned char *inVals, unsigned char *outVals, const uint32_t nOriginalValues, uint32_t *bytesProcessed)
+// -----------------------------------------------------------------------------------
+// Decode a block encoded by fbc264dedup. Previous blocks must have been decoded in order
+//    into one contiguous output buffer, as a repeated block is copied from
+//    outVals - distance*nOriginalValues.
+// Returns number of bytes output or negative if error
+{
+    if ((nOriginalValues > 5) && (inVals[0] == 0xc0))
+    {
+        // repeat block mode
+        const uint32_t distance=inVals[1] | ((uint32_t)inVals[2] << 8);
+        memcpy(outVals, outVals - distance * nOriginalValues, nOriginalValues);
+        *bytesProcessed = 3;
+        return (int32_t)nOriginalValues;
+    }
+    return fbc264d(inVals, outVals, nOriginalValues, bytesProcessed);
+} // end fbc264ddedup
+
+// -----------------------------------------------------------------------------------
+static inline void xorBlock(const unsigned char *inVals, const unsigned char *prevVals, unsigned char *outVals, const uint32_t nValues)
+// -----------------------------------------------------------------------------------
+{
+    // XOR 8 bytes at a time, then remaining bytes
+    uint64_t word;
+    uint64_t prevWord;
+    uint32_t i=0;
+    while (i + 8 <= nValues)
+    {
+        memcpy(&word, inVals+i, sizeof(word));
+        memcpy(&prevWord, prevVals+i, sizeof(prevWord));
+        word ^= prevWord;
+        memcpy(outVals+i, &word, sizeof(word));
+        i += 8;
+    }
+    while (i < nValues)
+    {
+        outVals[i] = inVals[i] ^ prevVals[i];
+        i++;
+    }
+} // end xorBlock
+
+// -----------------------------------------------------------------------------------
+static inline int32_t fbc264xor(const unsigned char *inVals, unsigned char *outVals, const uint32_t nValues, const unsigned char *prevVals)
+// -----------------------------------------------------------------------------------
+// fbc264xor: Compress nValues bytes as fbc264, or as the XOR of the block with the previous
+//    block when that is smaller: 0xe0, EXTENDED_XOR_MODE, then fbc264 output of the XOR values.
+//    Decode with fbc264dxor.
+// Arguments:
+//   inVals   input byte values
+//   outVals  output byte values if compressed, max of inVals bytes
+//   nValues  number of input byte values, 6 to 64
+//   prevVals previous block of nValues input bytes, or NULL for the first block
+// Returns number of bits compressed, 0 if not compressed, or -1 if error
+{
+    if ((nValues <= 5) || (nValues > MAX_FBC_BYTES))
+        return -1; // only values 6 to 64 supported as fbc25 uses all bits of first byte
+    
+    const int32_t nBits=fbc264(inVals, outVals, nValues);
+    if ((prevVals == NULL) || ((nBits > 0) && (nBits <= 24)))
+        return nBits; // first block or no improvement possible
+    
+    unsigned char xorVals[MAX_FBC_BYTES];
+    unsigned char xorOutVals[MAX_FBC_BYTES*2]; // encoders may write past nValues before failing
+    xorBlock(inVals, prevVals, xorVals, nValues);
+    const int32_t nBitsXor=fbc264(xorVals, xorOutVals, nValues);
+    if (nBitsXor <= 0)
+        return nBits;
+    const uint32_t nBytesXor=2 + ((uint32_t)nBitsXor + 7) / 8;
+    const uint32_t nBytes=(nBits > 0) ? ((uint32_t)nBits + 7) / 8 : nValues;
+    if (nBytesXor >= nBytes)
+        return nBits; // prediction does not help
+    outVals[0] = 0xe0; // indicate extended mode
+    outVals[1] = EXTENDED_XOR_MODE;
+    memcpy(outVals+2, xorOutVals, nBytesXor-2);
+    return nBitsXor + 16;
+} // end fbc264xor
+
+// -----------------------------------------------------------------------------------
+static inline int32_t fbc264dxor(const unsigned char *inVals, unsigned char *outVals, const uint32_t nOriginalValues, const unsigned char *prevVals, uint32_t *bytesProcessed)
+// -----------------------------------------------------------------------------------
+// Decode a block encoded by fbc264xor. prevVals is the previous decoded block of
+//    nOriginalValues bytes, or NULL for the first block.
+// Returns number of bytes output or negative if error
+{
+    if ((nOriginalValues > 5) && (inVals[0] == 0xe0) && (inVals[1] == EXTENDED_XOR_MODE))
+    {
+        if (prevVals == NULL)
+            return -13; // no previous block to predict from
+        const int32_t nBytesOut=fbc264d(inVals+2, outVals, nOriginalValues, bytesProcessed);
+        if (nBytesOut < 1)
+            return nBytesOut;
+        *bytesProcessed += 2;
+        xorBlock(outVals, prevVals, outVals, nOriginalValues);
+        return nBytesOut;
+    }
+    return fbc264d(inVals, outVals, nOriginalValues, bytesProcessed);
+} // end fbc264dxor
+
+// unique table state for one stream of blocks, initialize with fbcUniquesInit
+struct fbcUniques_s {
+    unsigned char uniques[MAX_UNIQUES]; // uniques of the most recent fixed bit or uniques mode block
+    unsigned char uniqueIndex[256]; // index + 1 to each value in uniques, 0 if not in uniques
+    uint32_t nUniques;
+};
+
+// -----------------------------------------------------------------------------------
+static inline void fbcUniquesInit(struct fbcUniques_s *uniquesState)
+// -----------------------------------------------------------------------------------
+{
+    memset(uniquesState, 0, sizeof(struct fbcUniques_s));
+} // end fbcUniquesInit
+
+// -----------------------------------------------------------------------------------
+static inline void setUniques(struct fbcUniques_s *uniquesState, const unsigned char *uniques, const uint32_t nUniques)
+// -----------------------------------------------------------------------------------
+{
+    for (uint32_t i=0; i<uniquesState->nUniques; i++)
+        uniquesState->uniqueIndex[uniquesState->uniques[i]] = 0;
+    for (uint32_t i=0; i<nUniques; i++)
+    {
+        uniquesState->uniques[i] = uniques[i];
+        uniquesState->uniqueIndex[uniques[i]] = (unsigned char)(i + 1);
+    }
+    uniquesState->nUniques = nUniques;
+} // end setUniques
 
+// -----------------------------------------------------------------------------------
+static inline void setFixedBitUniques(struct fbcUniques_s *uniquesState, const unsigned char *fbcVals)
+// -----------------------------------------------------------------------------------
+{
+    // save uniques that follow the first byte of 2 to 16 unique fixed bit coding
+    const uint32_t firstByte=fbcVals[0];
+    if (((firstByte & 1) == 0) && (firstByte & 0x1e))
+        setUniques(uniquesState, fbcVals+1, ((firstByte >> 1) & 0xf) + 1);
+} // end setFixedBitUniques
+
+// -----------------------------------------------------------------------------------
+static inline int32_t fbc264reuse(struct fbcUniques_s *uniquesState, const unsigned char *inVals, unsigned char *outVals, const uint32_t nValues)
+// -----------------------------------------------------------------------------------
+// fbc264reuse: Compress nValues bytes as fbc264, or as indexes to the uniques of the most recent
+//    fixed bit block plus up to 15 added uniques when that is smaller:
+//    0xe0, number of added uniques in high 4 bits over EXTENDED_UNIQUES_MODE, added uniques,
+//    then 1 to 4 bits for each value. Decode with fbc264dreuse using its own uniques state.
+// Arguments:
+//   uniquesState  stream state initialized by fbcUniquesInit
+//   inVals   input byte values
+//   outVals  output byte values if compressed, max of inVals bytes
+//   nValues  number of input byte values, 6 to 64
+// Returns number of bits compressed, 0 if not compressed, or -1 if error
+{
+    if ((nValues <= 5) || (nValues > MAX_FBC_BYTES))
+        return -1; // only values 6 to 64 supported as fbc25 uses all bits of first byte
+    
+    const int32_t nBits=fbc264(inVals, outVals, nValues);
+    const uint32_t nPrevUniques=uniquesState->nUniques;
+    if ((nPrevUniques == 0) || ((nBits > 0) && (nBits <= 24)))
+    {
+        if (nBits > 0)
+            setFixedBitUniques(uniquesState, outVals);
+        return nBits; // no uniques to reuse or no improvement possible
+    }
+    
+    // index each value to previous uniques, adding uniques not found
+    unsigned char *uniqueIndex=uniquesState->uniqueIndex;
+    unsigned char *uniques=uniquesState->uniques;
+    unsigned char valIndexes[MAX_FBC_BYTES];
+    uint32_t nUniques=nPrevUniques;
+    uint32_t i;
+    for (i=0; i<nValues; i++)
+    {
+        uint32_t index=uniqueIndex[inVals[i]];
+        if (index == 0)
+        {
+            if (nUniques == MAX_UNIQUES)
+                break; // too many uniques
+            uniques[nUniques++] = inVals[i];
+            index = uniqueIndex[inVals[i]] = (unsigned char)nUniques;
+        }
+        valIndexes[i] = (unsigned char)(index - 1);
+    }
+    uint32_t width=1;
+    while ((nUniques - 1) >> width)
+        width++;
+    const uint32_t nAdded=nUniques - nPrevUniques;
+    const uint32_t nBitsReuse=16 + nAdded * 8 + nValues * width;
+    const uint32_t nBytes=(nBits > 0) ? ((uint32_t)nBits + 7) / 8 : nValues;
+    if ((i < nValues) || ((nBitsReuse + 7) / 8 >= nBytes))
+    {
+        // reuse fails or is not smaller: remove added uniques and keep fbc264 output
+        for (i=nPrevUniques; i<nUniques; i++)
+            uniqueIndex[uniques[i]] = 0;
+        if (nBits > 0)
+            setFixedBitUniques(uniquesState, outVals);
+        return nBits;
+    }
+    uniquesState->nUniques = nUniques; // added uniques are kept for next block
+    
+    outVals[0] = 0xe0; // indicate extended mode
+    outVals[1] = (unsigned char)((nAdded << 4) | EXTENDED_UNIQUES_MODE);
+    uint32_t nextOutVal=2;
+    for (i=nPrevUniques; i<nUniques; i++)
+        outVals[nextOutVal++] = uniques[i];
+    uint64_t encodingBits=0;
+    uint32_t nEncodingBits=0;
+    for (i=0; i<nValues; i++)
+    {
+        encodingBits |= (uint64_t)valIndexes[i] << nEncodingBits;
+        nEncodingBits += width;
+        if (nEncodingBits >= 8)
+        {
+            outVals[nextOutVal++] = (unsigned char)encodingBits;
+            encodingBits >>= 8;
+            nEncodingBits -= 8;
+        }
+    }
+    if (nEncodingBits)
+        outVals[nextOutVal] = (unsigned char)encodingBits; // output last partial byte
+    return (int32_t)nBitsReuse;
+} // end fbc264reuse
+
+// -----------------------------------------------------------------------------------
+static inline int32_t fbc264dreuse(struct fbcUniques_s *uniquesState, const unsigned char *inVals, unsigned char *outVals, const uint32_t nOriginalValues, uint32_t *bytesProcessed)
+// -----------------------------------------------------------------------------------
+// Decode a block encoded by fbc264reuse. Every compressed block of the stream must be
+//    decoded in order with the same uniques state.
+// Returns number of bytes output or negative if error
+{
+    if ((nOriginalValues > 5) && (inVals[0] == 0xe0) && ((inVals[1] & 0xf) == EXTENDED_UNIQUES_MODE))
+    {
+        // add uniques to previous uniques without reloading them
+        const uint32_t nAdded=inVals[1] >> 4;
+        const uint32_t nUniques=uniquesState->nUniques + nAdded;
+        unsigned char *uniques=uniquesState->uniques;
+        if ((uniquesState->nUniques == 0) || (nUniques > MAX_UNIQUES))
+            return -14; // uniques state does not match encoder
+        uint32_t nextInVal=2;
+        for (uint32_t i=uniquesState->nUniques; i<nUniques; i++)
+        {
+            uniques[i] = inVals[nextInVal];
+            uniquesState->uniqueIndex[inVals[nextInVal++]] = (unsigned char)(i + 1);
+        }
+        uniquesState->nUniques = nUniques;
+        uint32_t width=1;
+        while ((nUniques - 1) >> width)
+            width++;
+        const uint64_t valueMask=(1 << width) - 1;
+        uint64_t encodingBits=0;
+        uint32_t nEncodingBits=0;
+        uint32_t nextOutVal=0;
+        while (nextOutVal < nOriginalValues)
+        {
+            if (nEncodingBits < width)
+            {
+                encodingBits |= (uint64_t)inVals[nextInVal++] << nEncodingBits;
+                nEncodingBits += 8;
+            }
+            outVals[nextOutVal++] = uniques[encodingBits & valueMask];
+            encodingBits >>= width;
+            nEncodingBits -= width;
+        }
+        *bytesProcessed = nextInVal;
+        return (int32_t)nOriginalValues;
+    }
+    const int32_t nBytesOut=fbc264d(inVals, outVals, nOriginalValues, bytesProcessed);
+    if (nBytesOut > 0)
+        setFixedBitUniques(uniquesState, inVals);
+    return nBytesOut;
+} // end fbc264dreuse
+
+// a record of 1 or more bytes in the record format of fbcRecordEncode
+struct fbcRecord_s {
+    const unsigned char *pVals; // compressed or original bytes of record
+    uint32_t nBytes; // number of bytes at pVals
+    uint32_t nValues; // number of original bytes
+    uint32_t compressed; // 1 if compressed by fbc25 or fbc264, 0 if original bytes
+};
+
+// -----------------------------------------------------------------------------------
+static inline uint64_t fbcRecordsBound(const uint64_t nBytes, const uint64_t nRecords)
+// -----------------------------------------------------------------------------------
+// Return max number of bytes output by fbcRecordsEncode for records totaling nBytes
+{
+    return nBytes + nRecords * 5; // 1 prefix byte for 63 bytes or fewer, up to 5 for 32-bit lengths
+} // end fbcRecordsBound
+
+// -----------------------------------------------------------------------------------
+static inline uint32_t fbcRecordEncode(const unsigned char *inVals, const uint32_t nValues, unsigned char *outVals)
+// -----------------------------------------------------------------------------------
+// Output one record: a prefix of nValues * 2 plus 1 if compressed, in 7-bit groups with the
+//    high bit set when another byte follows, then the fbc25 or fbc264 compressed bytes or
+//    the original bytes. Records of 63 bytes or fewer have a 1-byte prefix and
+//    longer ones, including 64-byte records, 2 or more.
+// Arguments:
+//   inVals   record bytes, compressed when 2 to 64 bytes
+//   nValues  number of record bytes
+//   outVals  output with room for nValues plus 5 bytes
+// Returns number of bytes output
+{
+    uint32_t nPrefixBytes=1;
+    while (((uint64_t)nValues << 1) >> (nPrefixBytes * 7))
+        nPrefixBytes++;
+    uint32_t compressed=0;
+    uint32_t nBytes=nValues;
+    if ((nValues >= MIN_FBC_BYTES) && (nValues <= MAX_FBC_BYTES))
+    {
+        // encoders may write a few bytes past nValues before failing, so use a local buffer
+        unsigned char compressedVals[MAX_FBC_BYTES*2];
+        int32_t nBits;
+        if (nValues < 6)
+            nBits = fbc25(inVals, compressedVals, nValues);
+        else
+            nBits = fbc264(inVals, compressedVals, nValues);
+        if ((nBits > 0) && (((uint32_t)nBits + 7) / 8 < nValues))
+        {
+            compressed = 1;
+            nBytes = ((uint32_t)nBits + 7) / 8;
+            memcpy(outVals+nPrefixBytes, compressedVals, nBytes);
+        }
+    }
+    if (!compressed)
+        memcpy(outVals+nPrefixBytes, inVals, nValues);
+    uint64_t prefix=((uint64_t)nValues << 1) | compressed;
+    for (uint32_t i=0; i<nPrefixBytes-1; i++)
+    {
+        outVals[i] = (unsigned char)(prefix | 0x80);
+        prefix >>= 7;
+    }
+    outVals[nPrefixBytes-1] = (unsigned char)prefix;
+    return nPrefixBytes + nBytes;
+} // end fbcRecordEncode
+
+// -----------------------------------------------------------------------------------
+static inline uint64_t fbcRecordsEncode(const unsigned char * const *recordVals, const uint32_t *recordLengths, const uint32_t nRecords, unsigned char *outVals)
+// -----------------------------------------------------------------------------------
+// Output nRecords records with fbcRecordEncode back to back.
+//    outVals must have room for fbcRecordsBound of the total record bytes.
+// Returns number of bytes output
+{
+    uint64_t nOutBytes=0;
+    for (uint32_t i=0; i<nRecords; i++)
+        nOutBytes += fbcRecordEncode(recordVals[i], recordLengths[i], outVals+nOutBytes);
+    return nOutBytes;
+} // end fbcRecordsEncode
+
+// -----------------------------------------------------------------------------------
+static inline int32_t fbcRecordNext(const unsigned char *inVals, const uint64_t nInBytes, uint64_t *position, struct fbcRecord_s *record)
+// -----------------------------------------------------------------------------------
+// Get the record at *position in nInBytes of records output by fbcRecordsEncode without
+//    decoding or copying it, and advance *position to the next record.
+// Returns 1 for a record, 0 at end of records, or negative if error
+{
+    uint64_t pos=*position;
+    uint64_t prefix=0;
+    uint32_t shift=0;
+    if (pos >= nInBytes)
+        return 0; // end of records
+    do
+    {
+        if ((pos >= nInBytes) || (shift > 28))
+            return -15; // incomplete or invalid prefix
+        prefix |= (uint64_t)(inVals[pos] & 0x7f) << shift;
+        shift += 7;
+    } while (inVals[pos++] & 0x80);
+    record->nValues = (uint32_t)(prefix >> 1);
+    record->compressed = (uint32_t)(prefix & 1);
+    record->pVals = inVals + pos;
+    if (record->compressed)
+    {
+        // fbc264size reads the header of the record, so near the end of input it sizes a
+        //    zero-padded copy, and -16 below reports a truncated record
+        unsigned char headerVals[MAX_FBC_BYTES*2];
+        const unsigned char *pHeaderVals=record->pVals;
+        if ((record->nValues < MIN_FBC_BYTES) || (record->nValues > MAX_FBC_BYTES))
+            return -15; // only records of 2 to 64 bytes are compressed
+        if (nInBytes - pos < MAX_FBC_BYTES)
+        {
+            memset(headerVals, 0, sizeof(headerVals));
+            memcpy(headerVals, record->pVals, nInBytes - pos);
+            pHeaderVals = headerVals;
+        }
+        const int32_t nBytes=fbc264size(pHeaderVals, record->nValues);
+        if (nBytes < 1)
+            return nBytes ? nBytes : -15;
+        record->nBytes = (uint32_t)nBytes;
+    }
+    else
+        record->nBytes = record->nValues;
+    if (pos + record->nBytes > nInBytes)
+        return -16; // record extends past end of input
+    *position = pos + record->nBytes;
+    return 1;
+} // end fbcRecordNext
+
+// -----------------------------------------------------------------------------------
+static inline int32_t fbcRecordDecode(const struct fbcRecord_s *record, unsigned char *outVals)
+// -----------------------------------------------------------------------------------
+// Decode a record from fbcRecordNext into record->nValues bytes at outVals.
+// Returns number of bytes output or negative if error
+{
+    uint32_t bytesProcessed;
+    if (!record->compressed)
+    {
+        memcpy(outVals, record->pVals, record->nValues);
+        return (int32_t)record->nValues;
+    }
+    return fbc264d(record->pVals, outVals, record->nValues, &bytesProcessed);
+} // end fbcRecordDecode
+
+// -----------------------------------------------------------------------------------
+// compressed-domain evaluation of predicates
+// -----------------------------------------------------------------------------------
+struct fbcPredicate_s {
+    uint32_t op; // FBC_PREDICATE_EQ, FBC_PREDICATE_NE, FBC_PREDICATE_LT, FBC_PREDICATE_GT or FBC_PREDICATE_IN
+    unsigned char value; // value compared for all but FBC_PREDICATE_IN
+    uint64_t inSet[4]; // for FBC_PREDICATE_IN, bit v%64 of inSet[v/64] set when v is in the set
+};
+
+// -----------------------------------------------------------------------------------
+static inline int32_t predicateSet(const struct fbcPredicate_s *predicate, uint64_t *matchSet)
+// -----------------------------------------------------------------------------------
+{
+    // set the 256 bits of matchSet for the byte values that satisfy predicate
+    const uint32_t word=predicate->value >> 6;
+    const uint64_t bit=(uint64_t)1 << (predicate->value & 63);
+    switch (predicate->op)
+    {
+        case FBC_PREDICATE_EQ:
+            for (uint32_t i=0; i<4; i++)
+                matchSet[i] = (i == word) ? bit : 0;
+            return 0;
+        case FBC_PREDICATE_NE:
+            for (uint32_t i=0; i<4; i++)
+                matchSet[i] = (i == word) ? ~bit : ~(uint64_t)0;
+            return 0;
+        case FBC_PREDICATE_LT:
+            for (uint32_t i=0; i<4; i++)
+                matchSet[i] = (i < word) ? ~(uint64_t)0 : (i == word) ? bit - 1 : 0;
+            return 0;
+        case FBC_PREDICATE_GT:
+            for (uint32_t i=0; i<4; i++)
+                matchSet[i] = (i > word) ? ~(uint64_t)0 : (i == word) ? ~((bit << 1) - 1) : 0;
+            return 0;
+        case FBC_PREDICATE_IN:
+            memcpy(matchSet, predicate->inSet, 4 * sizeof(uint64_t));
+            return 0;
+        default:
+            return -17; // unknown predicate operator
+    }
+} // end predicateSet
+
+// -----------------------------------------------------------------------------------
+static inline uint64_t matchesValue(const uint64_t *matchSet, const uint32_t val)
+// -----------------------------------------------------------------------------------
+{
+    return (matchSet[val >> 6] >> (val & 63)) & 1;
+} // end matchesValue
+
+// -----------------------------------------------------------------------------------
+static inline uint32_t fixedBitIndexes(const unsigned char *inVals, unsigned char *outIndexes, const uint32_t nOriginalValues, const uint32_t nUniques)
+// -----------------------------------------------------------------------------------
+{
+    // output the index to the uniques of each value of a fixed bit coded block of 2 to 16
+    //    uniques without looking up the uniques, returning number of bytes processed
+    const uint32_t firstByte=inVals[0];
+    const uint32_t nBits=(nUniques == 2) ? 1 : (nUniques <= 4) ? 2 : (nUniques <= 8) ? 3 : 4;
+    const uint64_t indexMask=((uint64_t)1 << nBits) - 1;
+    uint64_t encodingBits=0;
+    uint32_t nEncodingBits=0;
+    uint32_t nextInVal=(nBits == 1) ? 3 : nUniques + 1;
+    uint32_t nextOutVal=1;
+    outIndexes[0] = 0; // first value is always the first unique
+    if (nBits < 4)
+    {
+        // indexes of the values after the first start in the high bits of the first byte
+        encodingBits = firstByte >> 5;
+        nEncodingBits = (nBits == 2) ? 2 : 3;
+        encodingBits &= ((uint64_t)1 << nEncodingBits) - 1;
+    }
+    while (nextOutVal < nOriginalValues)
+    {
+        if (nEncodingBits < nBits)
+        {
+            encodingBits |= (uint64_t)inVals[nextInVal++] << nEncodingBits;
+            nEncodingBits += 8;
+        }
+        outIndexes[nextOutVal++] = (unsigned char)(encodingBits & indexMask);
+        encodingBits >>= nBits;
+        nEncodingBits -= nBits;
+    }
+    return nextInVal;
+} // end fixedBitIndexes
+
+// -----------------------------------------------------------------------------------
+static inline int32_t fbc264filter(const unsigned char *inVals, const uint32_t nOriginalValues, const struct fbcPredicate_s *predicate, uint64_t *outBitmask, uint32_t *bytesProcessed)
+// -----------------------------------------------------------------------------------
+// Evaluate predicate on each value of a block compressed by fbc264 and set bit i of
+//    outBitmask when value i satisfies it. Single unique, fixed bit, single value and
+//    7-bit blocks are evaluated without decoding: the uniques are checked first, so a block
+//    with no matching unique is rejected without reading its indexes. Other modes are decoded.
+// Arguments:
+//   inVals           compressed block
+//   nOriginalValues  number of values in the block
+//   predicate        operator and value or set of values to compare
+//   outBitmask       bit i set when value i satisfies predicate
+//   bytesProcessed   number of bytes in the compressed block
+// Returns number of values that satisfy predicate, or negative if error
+{
+    uint64_t matchSet[4];
+    int32_t ret;
+    if ((ret=predicateSet(predicate, matchSet)) < 0)
+        return ret;
+    if ((nOriginalValues < MIN_FBC_BYTES) || (nOriginalValues > MAX_FBC_BYTES))
+        return -1;
+    const uint64_t allValues=(nOriginalValues == 64) ? ~(uint64_t)0 : ((uint64_t)1 << nOriginalValues) - 1;
+    const uint32_t firstByte=inVals[0];
+    uint64_t bitmask=0;
+    if (firstByte & 1)
+    {
+        // single unique: all or none of the values match
+        uint32_t unique=firstByte >> 2;
+        if (!(firstByte & 2))
+            unique |= (uint32_t)(inVals[1] << 6) & 0xff;
+        *outBitmask = matchesValue(matchSet, unique) ? allValues : 0;
+        *bytesProcessed = (firstByte & 2) ? 1 : 2;
+        return (int32_t)popcount64(*outBitmask);
+    }
+    const uint32_t nUniques=((firstByte >> 1) & 0xf) + 1;
+    if ((nOriginalValues > 5) && (nUniques > 1))
+    {
+        // fixed bit coding: evaluate the uniques, then look up the index of each value
+        uint32_t matchMask=0;
+        for (uint32_t i=0; i<nUniques; i++)
+            matchMask |= (uint32_t)matchesValue(matchSet, inVals[i+1]) << i;
+        if (matchMask == 0)
+            bitmask = 0; // no unique matches: reject block
+        else if (matchMask == ((uint32_t)1 << nUniques) - 1)
+            bitmask = allValues; // every unique matches
+        else if (nUniques == 2)
+        {
+            // 1-bit indexes are the bitmask for the second unique
+            uint64_t indexBits=0;
+            const uint32_t nIndexBytes=(nOriginalValues - 4 + 7) / 8;
+            for (uint32_t i=0; i<nIndexBytes; i++)
+                indexBits |= (uint64_t)inVals[3+i] << (i * 8);
+            indexBits = (indexBits << 4) | ((firstByte >> 5) << 1);
+            bitmask = (matchMask == 2) ? indexBits & allValues : ~indexBits & allValues;
+        }
+        else
+        {
+            unsigned char indexes[MAX_FBC_BYTES];
+            fixedBitIndexes(inVals, indexes, nOriginalValues, nUniques);
+            for (uint32_t i=0; i<nOriginalValues; i++)
+                bitmask |= (uint64_t)((matchMask >> indexes[i]) & 1) << i;
+        }
+        *outBitmask = bitmask;
+        *bytesProcessed = (uint32_t)fbc264size(inVals, nOriginalValues);
+        return (int32_t)popcount64(bitmask);
+    }
+    if ((nOriginalValues > 5) && ((firstByte >> 5) == 1))
+    {
+        // single value mode: control bits give the positions of the single value
+        const uint32_t nControlBytes=(nOriginalValues - 1) / 8 + 1;
+        uint64_t controlBits=0;
+        for (uint32_t i=0; i<nControlBytes; i++)
+            controlBits |= (uint64_t)inVals[1+i] << (i * 8);
+        uint32_t nextInVal=nControlBytes + 1;
+        if (matchesValue(matchSet, inVals[nextInVal++]))
+            bitmask = controlBits & allValues;
+        for (uint32_t i=0; i<nOriginalValues; i++)
+        {
+            if (!((controlBits >> i) & 1))
+                bitmask |= matchesValue(matchSet, inVals[nextInVal++]) << i;
+        }
+        *outBitmask = bitmask;
+        *bytesProcessed = nextInVal;
+        return (int32_t)popcount64(bitmask);
+    }
+    if ((nOriginalValues > 5) && ((firstByte >> 5) == 2))
+    {
+        // 7-bit mode: all values are below 128
+        *bytesProcessed = (uint32_t)fbc264size(inVals, nOriginalValues);
+        if ((matchSet[0] | matchSet[1]) == 0)
+        {
+            *outBitmask = 0; // no value below 128 matches: reject block
+            return 0;
+        }
+        if ((matchSet[0] & matchSet[1]) == ~(uint64_t)0)
+        {
+            *outBitmask = allValues; // every value below 128 matches
+            return (int32_t)nOriginalValues;
+        }
+        // groups of 8 values are packed in 7 bytes, remaining values are full bytes
+        const uint32_t nPackedValues=nOriginalValues & ~(uint32_t)7;
+        uint64_t encodingBits=0;
+        uint32_t nEncodingBits=0;
+        uint32_t nextInVal=1;
+        for (uint32_t i=0; i<nOriginalValues; i++)
+        {
+            uint32_t val;
+            if (i < nPackedValues)
+            {
+                if (nEncodingBits < 7)
+                {
+                    encodingBits |= (uint64_t)inVals[nextInVal++] << nEncodingBits;
+                    nEncodingBits += 8;
+                }
+                val = (uint32_t)(encodingBits & 127);
+                encodingBits >>= 7;
+                nEncodingBits -= 7;
+            }
+            else
+                val = inVals[nextInVal++];
+            bitmask |= matchesValue(matchSet, val) << i;
+        }
+        *outBitmask = bitmask;
+        return (int32_t)popcount64(bitmask);
+    }
+    // other modes are decoded
+    unsigned char outVals[MAX_FBC_BYTES];
+    if ((ret=fbc264d(inVals, outVals, nOriginalValues, bytesProcessed)) < 0)
+        return ret;
+    for (uint32_t i=0; i<nOriginalValues; i++)
+        bitmask |= matchesValue(matchSet, outVals[i]) << i;
+    *outBitmask = bitmask;
+    return (int32_t)popcount64(bitmask);
+} // end fbc264filter
+
+// -----------------------------------------------------------------------------------
+// compressed-domain aggregates
+// -----------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------
+static inline int32_t fbc264histogram(const unsigned char *inVals, const uint32_t nOriginalValues, uint64_t *histogram, uint32_t *bytesProcessed)
+// -----------------------------------------------------------------------------------
+// Add the number of occurrences of each byte value in a block compressed by fbc264 to
+//    histogram[256]. Single unique, fixed bit and single value blocks are counted without
+//    decoding: 1-bit indexes are counted with popcount and 2 to 4-bit indexes are counted
+//    per index before adding to the uniques. Other modes are decoded.
+// Returns number of values counted, or negative if error
+{
+    if ((nOriginalValues < MIN_FBC_BYTES) || (nOriginalValues > MAX_FBC_BYTES))
+        return -1;
+    const uint64_t allValues=(nOriginalValues == 64) ? ~(uint64_t)0 : ((uint64_t)1 << nOriginalValues) - 1;
+    const uint32_t firstByte=inVals[0];
+    if (firstByte & 1)
+    {
+        // single unique
+        uint32_t unique=firstByte >> 2;
+        if (!(firstByte & 2))
+            unique |= (uint32_t)(inVals[1] << 6) & 0xff;
+        histogram[unique] += nOriginalValues;
+        *bytesProcessed = (firstByte & 2) ? 1 : 2;
+        return (int32_t)nOriginalValues;
+    }
+    const uint32_t nUniques=((firstByte >> 1) & 0xf) + 1;
+    if ((nOriginalValues > 5) && (nUniques == 2))
+    {
+        // 1-bit indexes: popcount gives occurrences of the second unique
+        uint64_t indexBits=0;
+        const uint32_t nIndexBytes=(nOriginalValues - 4 + 7) / 8;
+        for (uint32_t i=0; i<nIndexBytes; i++)
+            indexBits |= (uint64_t)inVals[3+i] << (i * 8);
+        indexBits = ((indexBits << 4) | ((firstByte >> 5) << 1)) & allValues;
+        const uint32_t nSecond=popcount64(indexBits);
+        histogram[inVals[1]] += nOriginalValues - nSecond;
+        histogram[inVals[2]] += nSecond;
+        *bytesProcessed = 3 + nIndexBytes;
+        return (int32_t)nOriginalValues;
+    }
+    if ((nOriginalValues > 5) && (nUniques > 2))
+    {
+        // 2 to 4-bit indexes: count each index, then add counts to the uniques
+        unsigned char indexes[MAX_FBC_BYTES];
+        uint32_t indexCounts[MAX_UNIQUES]={0};
+        *bytesProcessed = fixedBitIndexes(inVals, indexes, nOriginalValues, nUniques);
+        for (uint32_t i=0; i<nOriginalValues; i++)
+            indexCounts[indexes[i]]++;
+        for (uint32_t i=0; i<nUniques; i++)
+            histogram[inVals[i+1]] += indexCounts[i];
+        return (int32_t)nOriginalValues;
+    }
+    if ((nOriginalValues > 5) && ((firstByte >> 5) == 1))
+    {
+        // single value mode: control bits give occurrences of the single value
+        const uint32_t nControlBytes=(nOriginalValues - 1) / 8 + 1;
+        uint64_t controlBits=0;
+        for (uint32_t i=0; i<nControlBytes; i++)
+            controlBits |= (uint64_t)inVals[1+i] << (i * 8);
+        const uint32_t nSingle=popcount64(controlBits & allValues);
+        uint32_t nextInVal=nControlBytes + 1;
+        histogram[inVals[nextInVal++]] += nSingle;
+        for (uint32_t i=0; i<nOriginalValues-nSingle; i++)
+            histogram[inVals[nextInVal++]]++;
+        *bytesProcessed = nextInVal;
+        return (int32_t)nOriginalValues;
+    }
+    // other modes are decoded
+    unsigned char outVals[MAX_FBC_BYTES];
+    const int32_t ret=fbc264d(inVals, outVals, nOriginalValues, bytesProcessed);
+    if (ret < 0)
+        return ret;
+    for (uint32_t i=0; i<nOriginalValues; i++)
+        histogram[outVals[i]]++;
+    return (int32_t)nOriginalValues;
+} // end fbc264histogram
+
+// -----------------------------------------------------------------------------------
+static inline int32_t fbc264minmax(const unsigned char *inVals, const uint32_t nOriginalValues, unsigned char *minVal, unsigned char *maxVal, uint32_t *bytesProcessed)
+// -----------------------------------------------------------------------------------
+// Return in minVal and maxVal the smallest and largest values of a block compressed by
+//    fbc264. Fixed bit blocks use only the uniques and single unique blocks the unique.
+//    Other modes are decoded.
+// Returns 0 or negative if error
+{
+    if ((nOriginalValues < MIN_FBC_BYTES) || (nOriginalValues > MAX_FBC_BYTES))
+        return -1;
+    const uint32_t firstByte=inVals[0];
+    uint32_t minV=255;
+    uint32_t maxV=0;
+    if (firstByte & 1)
+    {
+        // single unique
+        uint32_t unique=firstByte >> 2;
+        if (!(firstByte & 2))
+            unique |= (uint32_t)(inVals[1] << 6) & 0xff;
+        *minVal = *maxVal = (unsigned char)unique;
+        *bytesProcessed = (firstByte & 2) ? 1 : 2;
+        return 0;
+    }
+    const uint32_t nUniques=((firstByte >> 1) & 0xf) + 1;
+    if ((nOriginalValues > 5) && (nUniques > 1))
+    {
+        // every unique occurs in the block
+        for (uint32_t i=0; i<nUniques; i++)
+        {
+            if (inVals[i+1] < minV)
+                minV = inVals[i+1];
+            if (inVals[i+1] > maxV)
+                maxV = inVals[i+1];
+        }
+        *minVal = (unsigned char)minV;
+        *maxVal = (unsigned char)maxV;
+        *bytesProcessed = (uint32_t)fbc264size(inVals, nOriginalValues);
+        return 0;
+    }
+    // other modes are decoded
+    unsigned char outVals[MAX_FBC_BYTES];
+    const int32_t ret=fbc264d(inVals, outVals, nOriginalValues, bytesProcessed);
+    if (ret < 0)
+        return ret;
+    for (uint32_t i=0; i<nOriginalValues; i++)
+    {
+        if (outVals[i] < minV)
+            minV = outVals[i];
+        if (outVals[i] > maxV)
+            maxV = outVals[i];
+    }
+    *minVal = (unsigned char)minV;
+    *maxVal = (unsigned char)maxV;
+    return 0;
+} // end fbc264minmax
+
+// -----------------------------------------------------------------------------------
+static inline int32_t fbc264count(const unsigned char *inVals, const uint32_t nOriginalValues, const unsigned char value, uint32_t *bytesProcessed)
+// -----------------------------------------------------------------------------------
+// Return number of occurrences of value in a block compressed by fbc264, or negative if error
+{
+    struct fbcPredicate_s predicate;
+    uint64_t bitmask;
+    predicate.op = FBC_PREDICATE_EQ;
+    predicate.value = value;
+    return fbc264filter(inVals, nOriginalValues, &predicate, &bitmask, bytesProcessed);
+} // end fbc264count
+
+// -----------------------------------------------------------------------------------
+static inline int64_t fbcStreamHistogram(const unsigned char *inVals, const uint64_t nInBytes, const uint64_t *compressedBits, const uint32_t blockSize, uint64_t *histogram)
+// -----------------------------------------------------------------------------------
+// Add the number of occurrences of each byte value in a stream of blocks to histogram[256]
+//    without decoding fixed bit blocks. The stream is the output of the main.c test bed:
+//    blocks of blockSize values each compressed by fbc25 or fbc264 or stored as is, with a
+//    final block of fewer values stored as is.
+// Arguments:
+//   inVals          compressed stream
+//   nInBytes        number of bytes in compressed stream
+//   compressedBits  one bit per block, from the high bit of each 64-bit word, 1 if compressed
+//   blockSize       number of values in each block, 2 to 64
+//   histogram       256 counts added to
+// Returns number of values counted, or negative if error
+{
+    uint64_t nextInVal=0;
+    uint64_t nValues=0;
+    uint64_t block=0;
+    uint32_t bytesProcessed;
+    if ((blockSize < MIN_FBC_BYTES) || (blockSize > MAX_FBC_BYTES))
+        return -1;
+    while (nextInVal < nInBytes)
+    {
+        if ((compressedBits[block / 64] << (block % 64)) & 0x8000000000000000)
+        {
+            const int32_t ret=fbc264histogram(inVals+nextInVal, blockSize, histogram, &bytesProcessed);
+            if (ret < 0)
+                return ret;
+            if (nextInVal + bytesProcessed > nInBytes)
+                return -16; // block extends past end of input
+            nextInVal += bytesProcessed;
+            nValues += blockSize;
+        }
+        else
+        {
+            // uncompressed block, shorter if last in stream
+            const uint64_t nBlockValues=(nInBytes - nextInVal < blockSize) ? nInBytes - nextInVal : blockSize;
+            for (uint64_t i=0; i<nBlockValues; i++)
+                histogram[inVals[nextInVal+i]]++;
+            nextInVal += nBlockValues;
+            nValues += nBlockValues;
+        }
+        block++;
+    }
+    return (int64_t)nValues;
+} // end fbcStreamHistogram
+
+// -----------------------------------------------------------------------------------
+// dictionary-code decoding
+// -----------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------
+static inline int32_t fbc264dcodes(const unsigned char *inVals, const uint32_t nOriginalValues, unsigned char *outUniques, unsigned char *outCodes, uint32_t *bytesProcessed)
+// -----------------------------------------------------------------------------------
+// Decode a block compressed by fbc264 as a table of up to 16 uniques and a code for each
+//    value that is its index in the table, so that the value is outUniques[outCodes[i]].
+//    Fixed bit blocks output their uniques and indexes as is without looking up the values.
+//    Blocks in other modes are decoded and coded in order of first occurrence.
+// Arguments:
+//   inVals           compressed block
+//   nOriginalValues  number of values in the block
+//   outUniques       table of up to 16 uniques
+//   outCodes         index to outUniques of each value
+//   bytesProcessed   number of bytes in the compressed block
+// Returns number of uniques, -18 if the block has more than 16 uniques or other negative if error
+{
+    if ((nOriginalValues < MIN_FBC_BYTES) || (nOriginalValues > MAX_FBC_BYTES))
+        return -1;
+    const uint32_t firstByte=inVals[0];
+    if (firstByte & 1)
+    {
+        // single unique
+        uint32_t unique=firstByte >> 2;
+        if (!(firstByte & 2))
+            unique |= (uint32_t)(inVals[1] << 6) & 0xff;
+        outUniques[0] = (unsigned char)unique;
+        memset(outCodes, 0, nOriginalValues);
+        *bytesProcessed = (firstByte & 2) ? 1 : 2;
+        return 1;
+    }
+    const uint32_t nUniques=((firstByte >> 1) & 0xf) + 1;
+    if ((nOriginalValues > 5) && (nUniques > 1))
+    {
+        // fixed bit coding: the uniques follow the first byte
+        memcpy(outUniques, inVals+1, nUniques);
+        *bytesProcessed = fixedBitIndexes(inVals, outCodes, nOriginalValues, nUniques);
+        return (int32_t)nUniques;
+    }
+    // other modes are decoded
+    unsigned char outVals[MAX_FBC_BYTES];
+    unsigned char codes[256];
+    uint32_t nCodes=0;
+    const int32_t ret=fbc264d(inVals, outVals, nOriginalValues, bytesProcessed);
+    if (ret < 0)
+        return ret;
+    memset(codes, 0xff, sizeof(codes));
+    for (uint32_t i=0; i<nOriginalValues; i++)
+    {
+        const uint32_t val=outVals[i];
+        if (codes[val] == 0xff)
+        {
+            if (nCodes == MAX_UNIQUES)
+                return -18; // more than 16 uniques
+            outUniques[nCodes] = (unsigned char)val;
+            codes[val] = (unsigned char)nCodes++;
+        }
+        outCodes[i] = codes[val];
+    }
+    return (int32_t)nCodes;
+} // end fbc264dcodes
+
+// -----------------------------------------------------------------------------------
+static inline int32_t fbc264dcodes16(const unsigned char *inVals, const uint32_t nOriginalValues, unsigned char *outUniques, uint16_t *outCodes, uint32_t *bytesProcessed)
+// -----------------------------------------------------------------------------------
+// fbc264dcodes with 16-bit codes
+{
+    unsigned char codes[MAX_FBC_BYTES];
+    const int32_t nUniques=fbc264dcodes(inVals, nOriginalValues, outUniques, codes, bytesProcessed);
+    if (nUniques < 0)
+        return nUniques;
+    for (uint32_t i=0; i<nOriginalValues; i++)
+        outCodes[i] = codes[i];
+    return nUniques;
+} // end fbc264dcodes16
+
+// -----------------------------------------------------------------------------------
+static inline int32_t fbc264dcodes32(const unsigned char *inVals, const uint32_t nOriginalValues, unsigned char *outUniques, uint32_t *outCodes, uint32_t *bytesProcessed)
+// -----------------------------------------------------------------------------------
+// fbc264dcodes with 32-bit codes
+{
+    unsigned char codes[MAX_FBC_BYTES];
+    const int32_t nUniques=fbc264dcodes(inVals, nOriginalValues, outUniques, codes, bytesProcessed);
+    if (nUniques < 0)
+        return nUniques;
+    for (uint32_t i=0; i<nOriginalValues; i++)
+        outCodes[i] = codes[i];
+    return nUniques;
+} // end fbc264dcodes32
+
+// -----------------------------------------------------------------------------------
+// partial decoding of a block
+// -----------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------
+static inline uint32_t readBits(const unsigned char *inVals, const uint32_t bitOffset, const uint32_t width)
+// -----------------------------------------------------------------------------------
+{
+    // read width bits of 1 to 8 at bitOffset from the start of inVals, reading the next byte
+    //    only when the bits cross into it
+    const unsigned char *pInVal=inVals + bitOffset / 8;
+    const uint32_t shift=bitOffset & 7;
+    uint32_t bits=(uint32_t)pInVal[0] >> shift;
+    if (shift + width > 8)
+        bits |= (uint32_t)pInVal[1] << (8 - shift);
+    return bits & ((1 << width) - 1);
+} // end readBits
+
+// -----------------------------------------------------------------------------------
+static inline int32_t fbc264dat(const unsigned char *inVals, const uint32_t nOriginalValues, const uint32_t index)
+// -----------------------------------------------------------------------------------
+// Decode only value index of a block compressed by fbc264. Values of fixed bit, 7-bit, frame
+//    of reference, nibble and fixed alphabet blocks are at a known bit offset. Single value
+//    and text blocks count the control bits before index with popcount.
+// Returns the value, -1 if index is out of range or other negative if error
+{
+    if ((nOriginalValues < MIN_FBC_BYTES) || (nOriginalValues > MAX_FBC_BYTES) || (index >= nOriginalValues))
+        return -1;
+    const uint32_t firstByte=inVals[0];
+    if (firstByte & 1)
+    {
+        // single unique
+        uint32_t unique=firstByte >> 2;
+        if (!(firstByte & 2))
+            unique |= (uint32_t)(inVals[1] << 6) & 0xff;
+        return (int32_t)unique;
+    }
+    if (nOriginalValues <= 5)
+    {
+        unsigned char outVals[5];
+        uint32_t bytesProcessed;
+        const int32_t ret=fbc25d(inVals, outVals, nOriginalValues, &bytesProcessed);
+        return (ret < 0) ? ret : outVals[index];
+    }
+    const uint32_t nUniques=((firstByte >> 1) & 0xf) + 1;
+    const uint32_t i=index;
+    switch (nUniques)
+    {
+        case 1:
+            break; // modes without uniques
+        case 2:
+            // 1-bit indexes: values 1 to 3 in the first byte, then from the fourth byte
+            return inVals[1 + ((i < 4) ? (i ? (firstByte >> (4 + i)) & 1 : 0) : readBits(inVals, 24 + (i - 4), 1))];
+        case 3:
+        case 4:
+            // 2-bit indexes: value 1 in the first byte, then after the uniques
+            return inVals[1 + ((i < 2) ? (i ? (firstByte >> 5) & 3 : 0) : readBits(inVals, (nUniques + 1) * 8 + (i - 2) * 2, 2))];
+        case 5:
+        case 6:
+        case 7:
+        case 8:
+            // 3-bit indexes: value 1 in the first byte, then after the uniques
+            return inVals[1 + ((i < 2) ? (i ? (firstByte >> 5) & 7 : 0) : readBits(inVals, (nUniques + 1) * 8 + (i - 2) * 3, 3))];
+        default:
+            // 4-bit indexes after the uniques
+            return inVals[1 + (i ? readBits(inVals, (nUniques + 1) * 8 + (i - 1) * 4, 4) : 0)];
+    }
+    switch (firstByte >> 5)
+    {
+        case 0:
+        case 1:
+        {
+            // text and single value modes: control bit 1 for each 8-bit value after the
+            //    control bytes, 0 for a text char or the single value
+            const uint32_t nControlBytes=(nOriginalValues - 1) / 8 + 1;
+            uint64_t controlBits=0;
+            for (uint32_t j=0; j<nControlBytes; j++)
+                controlBits |= (uint64_t)inVals[1+j] << (j * 8);
+            const uint32_t nLiterals=popcount64(controlBits & (((uint64_t)1 << i) - 1));
+            const uint32_t nextInVal=nControlBytes + 1;
+            if (firstByte == 0x20)
+            {
+                // single value mode, where single value follows control bytes
+                if (controlBits & ((uint64_t)1 << i))
+                    return inVals[nextInVal];
+                return inVals[nextInVal + 1 + i - nLiterals];
+            }
+            // text mode: a byte of two 4-bit text char indexes is output at the first of each
+            //    pair of text chars, between the 8-bit values
+            const uint32_t nTextChars=i - nLiterals;
+            if (controlBits & ((uint64_t)1 << i))
+                return inVals[nextInVal + nLiterals + (nTextChars + 1) / 2];
+            uint64_t textBits=~controlBits;
+            for (uint32_t j=0; j<(nTextChars & ~(uint32_t)1); j++)
+                textBits &= textBits - 1; // clear text chars before the first of this pair
+            const uint32_t pairStart=popcount64((textBits & (0 - textBits)) - 1);
+            const uint32_t pairByte=inVals[nextInVal + pairStart - nTextChars / 2];
+            return (int32_t)textChars[(nTextChars & 1) ? pairByte >> 4 : pairByte & 15];
+        }
+        case 2:
+        {
+            // 7-bit mode: groups of 8 values packed in 7 bytes, remaining values are full bytes
+            const uint32_t nPackedValues=nOriginalValues & ~(uint32_t)7;
+            if (i < nPackedValues)
+                return (int32_t)readBits(inVals, 8 + i * 7, 7);
+            return inVals[1 + nPackedValues / 8 * 7 + i - nPackedValues];
+        }
+        case 3:
+            // frame of reference mode
+            return (int32_t)((inVals[1] + readBits(inVals, 19 + i * ((inVals[2] & 7) + 1), (inVals[2] & 7) + 1)) & 0xff);
+        case 4:
+        {
+            // nibble mode: 4-bit low nibbles with one high nibble, or 5-bit with a selector bit
+            const uint32_t highNibbles[2]={(uint32_t)(inVals[1] & 0xf) << 4, (uint32_t)inVals[1] & 0xf0};
+            if (highNibbles[0] == highNibbles[1])
+                return (int32_t)(highNibbles[0] | readBits(inVals, 16 + i * 4, 4));
+            const uint32_t bits=readBits(inVals, 16 + i * 5, 5);
+            return (int32_t)(highNibbles[bits >> 4] | (bits & 0xf));
+        }
+        case 5:
+            // fixed alphabet mode
+            if (i + (inVals[1] >> 4) >= nOriginalValues)
+                return '='; // padding chars at the end of base64 or base32
+            switch (inVals[1] & 0xf)
+            {
+                case HEX_LOWER_ALPHABET:
+                case HEX_UPPER_ALPHABET:
+                    return hexChars[inVals[1]][readBits(inVals, 16 + i * 4, 4)];
+                case BASE64_ALPHABET:
+                    return base64Chars[readBits(inVals, 16 + i * 6, 6)];
+                case BASE32_ALPHABET:
+                    return base32Chars[readBits(inVals, 16 + i * 5, 5)];
+                default:
+                    return -10; // unexpected program error
+            }
+        case 6:
+            return -11; // repeat block mode must be decoded by fbc264ddedup
+        default:
+            return -12; // extended mode must be decoded by its stream decoder
+    }
+} // end fbc264dat
+
+// -----------------------------------------------------------------------------------
+static inline int32_t fbc264drange(const unsigned char *inVals, const uint32_t nOriginalValues, const uint32_t start, const uint32_t count, unsigned char *outVals)
+// -----------------------------------------------------------------------------------
+// Decode only values start to start+count-1 of a block compressed by fbc264 into outVals
+// Returns count, -1 if the values are out of range or other negative if error
+{
+    if ((start > nOriginalValues) || (count > nOriginalValues - start))
+        return -1;
+    for (uint32_t i=0; i<count; i++)
+    {
+        const int32_t val=fbc264dat(inVals, nOriginalValues, start + i);
+        if (val < 0)
+            return val;
+        outVals[i] = (unsigned char)val;
+    }
+    return (int32_t)count;
+} // end fbc264drange
+
+// -----------------------------------------------------------------------------------
+// positions of consecutive blocks
+// -----------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------
+static inline int32_t fbc264positions(const unsigned char *inVals, const uint32_t nOriginalValues, const uint32_t nBlocks, const unsigned char **blockVals)
+// -----------------------------------------------------------------------------------
+// Set blockVals to the positions of nBlocks consecutive compressed blocks starting at inVals
+//    using fbc264size, so that any of them can be decoded by fbc264d without the others.
+// Returns number of bytes in the blocks, or negative if error
+{
+    uint32_t nextInVal=0;
+    for (uint32_t i=0; i<nBlocks; i++)
+    {
+        blockVals[i] = inVals + nextInVal;
+        const int32_t nBytes=fbc264size(inVals+nextInVal, nOriginalValues);
+        if (nBytes < 0)
+            return nBytes;
+        nextInVal += (uint32_t)nBytes;
+    }
+    return (int32_t)nextInVal;
+} // end fbc264positions
+
+// -----------------------------------------------------------------------------------
+// batches of 2 to 5 byte records
+// -----------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------
+static inline uint32_t encodeRecord25(const unsigned char *inVals, unsigned char *outVals, const uint32_t nValues)
+// -----------------------------------------------------------------------------------
+{
+    // output one record compressed by fbc25 if that saves a byte, otherwise as is
+    const int32_t nBits=fbc25(inVals, outVals, nValues);
+    if ((nBits > 0) && (((uint32_t)nBits + 7) / 8 < nValues))
+        return ((uint32_t)nBits + 7) / 8;
+    memcpy(outVals, inVals, nValues);
+    return nValues;
+} // end encodeRecord25
+
+// -----------------------------------------------------------------------------------
+static inline uint64_t encodeRecords25(const unsigned char *inVals, unsigned char *outVals, const uint32_t nValues, const uint64_t nRecords, unsigned char *outLengths)
+// -----------------------------------------------------------------------------------
+{
+    // nValues is a constant where this is called, so fbc25 is specialized for the record size
+    uint64_t nextOutVal=0;
+    for (uint64_t i=0; i<nRecords; i++)
+    {
+        const uint32_t nBytes=encodeRecord25(inVals+i*nValues, outVals+nextOutVal, nValues);
+        outLengths[i] = (unsigned char)nBytes;
+        nextOutVal += nBytes;
+    }
+    return nextOutVal;
+} // end encodeRecords25
+
+// -----------------------------------------------------------------------------------
+static inline int64_t fbc25batch(const unsigned char *inVals, unsigned char *outVals, const uint32_t nValues, const uint64_t nRecords, unsigned char *outLengths)
+// -----------------------------------------------------------------------------------
+// Compress nRecords consecutive records of nValues bytes each, 2 to 5, with fbc25. The
+//    output of each record is back to back in outVals: its fbc25 bytes when they are fewer
+//    than nValues, otherwise its original bytes. outLengths gets the output bytes of each
+//    record, so a record is compressed when its length is less than nValues. The switch on
+//    nValues is done once for the batch instead of once for each record.
+// Arguments:
+//   inVals      records
+//   outVals     output with room for nRecords * nValues bytes
+//   nValues     bytes in each record, 2 to 5
+//   nRecords    number of records
+//   outLengths  output bytes of each record
+// Returns number of bytes output, or -2 if nValues out of range
+{
+    switch (nValues)
+    {
+        case 2:
+            return (int64_t)encodeRecords25(inVals, outVals, 2, nRecords, outLengths);
+        case 3:
+            return (int64_t)encodeRecords25(inVals, outVals, 3, nRecords, outLengths);
+        case 4:
+            return (int64_t)encodeRecords25(inVals, outVals, 4, nRecords, outLengths);
+        case 5:
+            return (int64_t)encodeRecords25(inVals, outVals, 5, nRecords, outLengths);
+        default:
+            return -2; // only values 2 to 5 supported
+    }
+} // end fbc25batch
+
+// -----------------------------------------------------------------------------------
+static inline int64_t decodeRecords25(const unsigned char *inVals, unsigned char *outVals, const uint32_t nValues, const uint64_t nRecords, const unsigned char *inLengths)
+// -----------------------------------------------------------------------------------
+{
+    uint64_t nextInVal=0;
+    uint32_t bytesProcessed;
+    for (uint64_t i=0; i<nRecords; i++)
+    {
+        const uint32_t nBytes=inLengths[i];
+        if (nBytes < nValues)
+        {
+            const int32_t ret=fbc25d(inVals+nextInVal, outVals+i*nValues, nValues, &bytesProcessed);
+            if (ret < 0)
+                return ret;
+        }
+        else
+            memcpy(outVals+i*nValues, inVals+nextInVal, nValues);
+        nextInVal += nBytes;
+    }
+    return (int64_t)nextInVal;
+} // end decodeRecords25
+
+// -----------------------------------------------------------------------------------
+static inline int64_t fbc25dbatch(const unsigned char *inVals, unsigned char *outVals, const uint32_t nValues, const uint64_t nRecords, const unsigned char *inLengths)
+// -----------------------------------------------------------------------------------
+// Decode nRecords records of nValues bytes each output by fbc25batch, given the length of
+//    each record in inLengths. Records are decoded by fbc25d rather than fbc264dfast, so
+//    outVals needs no slack: fbc264dfast only speeds up blocks of 6 or more values, and
+//    with nValues fixed for the batch each record is already a fixed-size decode or copy.
+// Returns number of bytes processed, or negative if error
+{
+    switch (nValues)
+    {
+        case 2:
+            return decodeRecords25(inVals, outVals, 2, nRecords, inLengths);
+        case 3:
+            return decodeRecords25(inVals, outVals, 3, nRecords, inLengths);
+        case 4:
+            return decodeRecords25(inVals, outVals, 4, nRecords, inLengths);
+        case 5:
+            return decodeRecords25(inVals, outVals, 5, nRecords, inLengths);
+        default:
+            return -2; // only values 2 to 5 supported
+    }
+} // end fbc25dbatch
+
+// -----------------------------------------------------------------------------------
+// fixed-rate mode
+// -----------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------
+static inline int32_t fbc264fixedrate(const unsigned char *inVals, unsigned char *outVals, const uint32_t nValues, const uint32_t nFixedBytes)
+// -----------------------------------------------------------------------------------
+// Compress nValues bytes with fbc264 into exactly nFixedBytes bytes, padding with zeros,
+//    so that in a stream every compressed block is nFixedBytes and every block not
+//    compressed is nValues. fbcFixedRatePosition gives the position of any block.
+// Returns nFixedBytes, 0 if the block does not compress to nFixedBytes or fewer, or
+//    negative if error
+{
+    unsigned char compressedVals[MAX_FBC_LARGE_BYTES*2]; // encoders may write past nValues before failing
+    if ((nFixedBytes == 0) || (nFixedBytes >= nValues))
+        return -1;
+    const int32_t nBits=fbc264(inVals, compressedVals, nValues);
+    if (nBits <= 0)
+        return nBits;
+    const uint32_t nBytes=((uint32_t)nBits + 7) / 8;
+    if (nBytes > nFixedBytes)
+        return 0; // does not fit
+    memcpy(outVals, compressedVals, nBytes);
+    memset(outVals+nBytes, 0, nFixedBytes - nBytes);
+    return (int32_t)nFixedBytes;
+} // end fbc264fixedrate
+
+// -----------------------------------------------------------------------------------
+static inline int32_t fbc264dfixedrate(const unsigned char *inVals, unsigned char *outVals, const uint32_t nOriginalValues, const uint32_t nFixedBytes, uint32_t *bytesProcessed)
+// -----------------------------------------------------------------------------------
+// Decode a block output by fbc264fixedrate. bytesProcessed is nFixedBytes.
+// Returns number of bytes output, or negative if error
+{
+    const int32_t ret=fbc264d(inVals, outVals, nOriginalValues, bytesProcessed);
+    if (ret < 0)
+        return ret;
+    if (*bytesProcessed > nFixedBytes)
+        return -1;
+    *bytesProcessed = nFixedBytes;
+    return ret;
+} // end fbc264dfixedrate
+
+// -----------------------------------------------------------------------------------
+static inline uint64_t fbcFixedRatePosition(const uint64_t *compressedBits, const uint64_t block, const uint32_t blockSize, const uint32_t nFixedBytes)
+// -----------------------------------------------------------------------------------
+// Return the position in a fixed-rate stream of block number block, from the number of
+//    compressed blocks before it. compressedBits has one bit per block, from the high bit of
+//    each 64-bit word, 1 if compressed, as output by the test bed.
+{
+    uint64_t nCompressed=0;
+    for (uint64_t i=0; i<block/64; i++)
+        nCompressed += popcount64(compressedBits[i]);
+    if (block % 64)
+        nCompressed += popcount64(compressedBits[block/64] >> (64 - block % 64));
+    return block * blockSize - nCompressed * (blockSize - nFixedBytes);
+} // end fbcFixedRatePosition
+
+// -----------------------------------------------------------------------------------
+// incompressible skipping
+// -----------------------------------------------------------------------------------
+// skip state for one stream of blocks, initialize with fbcSkipInit
+struct fbcSkip_s {
+    uint32_t nFailures; // consecutive blocks tried that did not compress
+    uint32_t nSkipBlocks; // blocks left to output uncompressed without trying
+    uint64_t nSkippedBlocks; // total blocks not tried
+};
+
+// -----------------------------------------------------------------------------------
+static inline void fbcSkipInit(struct fbcSkip_s *skip)
+// -----------------------------------------------------------------------------------
+{
+    memset(skip, 0, sizeof(struct fbcSkip_s));
+} // end fbcSkipInit
+
+// -----------------------------------------------------------------------------------
+static inline int32_t fbc264skip(struct fbcSkip_s *skip, const unsigned char *inVals, unsigned char *outVals, const uint32_t nValues)
+// -----------------------------------------------------------------------------------
+// fbc264skip: Compress nValues bytes as fbc264, skipping blocks in incompressible regions.
+//    After SKIP_TRIGGER_FAILURES blocks in a row do not compress, only every few blocks is
+//    tried and the blocks between are returned as not compressed without being examined.
+//    The blocks skipped after each failed try grow by one for every SKIP_TRIGGER_FAILURES
+//    more failures up to SKIP_MAX_BLOCKS, and return to none when a tried block compresses.
+//    Every block of a stream must be passed in order. Decode with fbc264d.
+// Arguments:
+//   skip     stream state initialized by fbcSkipInit
+//   inVals   input byte values
+//   outVals  output byte values if compressed, max of inVals bytes
+//   nValues  number of input byte values, 2 to 64
+// Returns number of bits compressed, 0 if not compressed, or negative if error
+{
+    if (skip->nSkipBlocks)
+    {
+        skip->nSkipBlocks--;
+        skip->nSkippedBlocks++;
+        return 0;
+    }
+    const int32_t nBits=fbc264(inVals, outVals, nValues);
+    if (nBits != 0)
+    {
+        skip->nFailures = 0;
+        return nBits;
+    }
+    skip->nFailures++;
+    skip->nSkipBlocks = skip->nFailures / SKIP_TRIGGER_FAILURES;
+    if (skip->nSkipBlocks > SKIP_MAX_BLOCKS)
+        skip->nSkipBlocks = SKIP_MAX_BLOCKS;
+    return 0;
+} // end fbc264skip
+
+// -----------------------------------------------------------------------------------
+// mode prediction
+// -----------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------
+static inline uint32_t fbc264mode(const unsigned char *inVals)
+// -----------------------------------------------------------------------------------
+// Return the FBC_MODE of a block compressed by fbc264 from its first byte
+{
+    const uint32_t firstByte=inVals[0];
+    if (firstByte & 0x1f)
+        return FBC_MODE_FIXED_BIT; // single unique or 2 to 16 uniques
+    return (firstByte >> 5) + 1; // modes selected by bits 5-7
+} // end fbc264mode
+
+// mode prediction state for one stream of blocks, initialize with fbcPredictInit
+struct fbcPredict_s {
+    uint32_t mode; // FBC_MODE of the most recent block, FBC_MODE_NONE if not compressed
+    uint32_t singleValue; // single value of the most recent single value mode block
+    uint32_t nPredicted; // blocks encoded in the predicted mode since the last full check
+    uint64_t nHits; // total blocks encoded in the predicted mode
+};
+
+// -----------------------------------------------------------------------------------
+static inline void fbcPredictInit(struct fbcPredict_s *predict)
+// -----------------------------------------------------------------------------------
+{
+    memset(predict, 0, sizeof(struct fbcPredict_s));
+    predict->mode = FBC_MODE_NONE;
+} // end fbcPredictInit
+
+// -----------------------------------------------------------------------------------
+static inline int32_t encodePredictedMode(const struct fbcPredict_s *predict, const unsigned char *inVals, unsigned char *outVals, const uint32_t nValues)
+// -----------------------------------------------------------------------------------
+{
+    // encode in the predicted mode, each encoder verifying the values fit and compress
+    // return 0 if values do not compress in that mode
+    switch (predict->mode)
+    {
+        case FBC_MODE_TEXT:
+            return encodeTextMode(inVals, outVals, nValues);
+        case FBC_MODE_SINGLE_VALUE:
+        {
+            uint32_t nRepeats=0;
+            for (uint32_t i=0; i<nValues; i++)
+                nRepeats += (inVals[i] == predict->singleValue);
+            if ((nRepeats < nValues/4+1) || (nRepeats <= (nValues - 1) / 8 + 3))
+                return 0; // too few repeats of single value to compress
+            return encodeSingleValueMode(inVals, outVals, nValues, (int32_t)predict->singleValue);
+        }
+        case FBC_MODE_FRAME_OF_REFERENCE:
+            return encodeFrameOfReference(inVals, outVals, nValues);
+        case FBC_MODE_NIBBLE:
+        case FBC_MODE_FIXED_ALPHABET:
+        {
+            // hex alphabets are output by encodeNibbleMode, so try both in the order of fbc264
+            int32_t nBits;
+            if ((nBits = encodeNibbleMode(inVals, outVals, nValues, nValues * 8)) > 0)
+                return nBits;
+            return encodeFixedAlphabet(inVals, outVals, nValues);
+        }
+        default:
+            return 0; // fixed bit coding is first in fbc264, and 7-bit mode fits any ASCII block
+    }
+} // end encodePredictedMode
+
+// -----------------------------------------------------------------------------------
+static inline int32_t fbc264predict(struct fbcPredict_s *predict, const unsigned char *inVals, unsigned char *outVals, const uint32_t nValues)
+// -----------------------------------------------------------------------------------
+// fbc264predict: Compress nValues bytes as fbc264, first trying the mode of the previous
+//    block. Blocks of text, single value, frame of reference, nibble and fixed alphabet
+//    modes skip the checks of fbc264 for the modes before them when the block
+//    before was the same mode. Output of a mode is identical to that of fbc264, though
+//    fbc264 could select another mode. Every PREDICT_CHECK_BLOCKS blocks in a predicted
+//    mode, the next block is passed through fbc264 to learn the mode again.
+//    Every block of a stream must be passed in order. Decode with fbc264d.
+// Arguments:
+//   predict  stream state initialized by fbcPredictInit
+//   inVals   input byte values
+//   outVals  output byte values if compressed, max of inVals bytes
+//   nValues  number of input byte values, 2 to 64
+// Returns number of bits compressed, 0 if not compressed, or negative if error
+{
+    int32_t nBits;
+    if ((nValues > 5) && (nValues <= MAX_FBC_BYTES) && (predict->nPredicted < PREDICT_CHECK_BLOCKS) &&
+        ((nBits=encodePredictedMode(predict, inVals, outVals, nValues)) > 0))
+    {
+        predict->nPredicted++;
+        predict->nHits++;
+        return nBits;
+    }
+    predict->nPredicted = 0;
+    nBits = fbc264(inVals, outVals, nValues);
+    if ((nBits <= 0) || (nValues <= 5))
+    {
+        predict->mode = FBC_MODE_NONE;
+        return nBits;
+    }
+    predict->mode = fbc264mode(outVals);
+    if (predict->mode == FBC_MODE_SINGLE_VALUE)
+        predict->singleValue = outVals[(nValues-1)/8+2];
+    return nBits;
+} // end fbc264predict
+
+// -----------------------------------------------------------------------------------
+// compression levels
+// -----------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------
+static inline int32_t fbc264level(const unsigned char *inVals, unsigned char *outVals, const uint32_t nValues, const uint32_t level)
+// -----------------------------------------------------------------------------------
+// fbc264level: Compress nValues bytes as fbc264 at a compression level. Level 0 is fbc264,
+//    which outputs the first mode that passes its checks. Level 1 and above count the
+//    values of the block in one pass, compute the exact output size of fixed bit, text,
+//    single value and 7-bit modes from the counts, encode frame of reference, nibble and
+//    fixed alphabet modes to get their sizes, then output the smallest. Decode with fbc264d.
+// Arguments:
+//   inVals   input byte values
+//   outVals  output byte values if compressed, max of inVals bytes
+//   nValues  number of input byte values, 2 to 256
+//   level    0 for fbc264, 1 for the smallest output of all modes
+// Returns number of bits compressed, 0 if not compressed, or negative if error
+{
+    if ((level == 0) || (nValues <= 5) || (nValues > MAX_FBC_BYTES))
+        return fbc264(inVals, outVals, nValues); // large blocks are output in the smallest mode
+
+    unsigned char val256[256];
+    uint32_t uniqueOccurrence[256];
+    uint32_t nUniqueVals=0;
+    uint32_t highBitCheck=0;
+    uint32_t highNibbleBits=0; // a one for each high nibble encountered
+    uint32_t nTextChars=0;
+    uint32_t minVal=inVals[0];
+    uint32_t maxVal=inVals[0];
+    uint32_t singleValue=inVals[0];
+    memset(val256, 0, sizeof(val256));
+    for (uint32_t i=0; i<nValues; i++)
+    {
+        const uint32_t inVal=inVals[i];
+        highBitCheck |= inVal;
+        highNibbleBits |= 1 << (inVal >> 4);
+        nTextChars += (textEncoding[inVal] < 16);
+        if (inVal < minVal)
+            minVal = inVal;
+        else if (inVal > maxVal)
+            maxVal = inVal;
+        if (val256[inVal]++ == 0)
+        {
+            uniqueOccurrence[inVal] = nUniqueVals++;
+            if (nUniqueVals <= MAX_UNIQUES)
+                outVals[nUniqueVals] = (unsigned char)inVal; // store unique starting at second byte
+        }
+        else if (val256[inVal] > val256[singleValue])
+            singleValue = inVal;
+    }
+
+    // sizes in bits of each mode, nValues * 8 if the mode does not compress
+    const uint32_t nControlBytes=(nValues - 1) / 8 + 1;
+    uint32_t bestMode=FBC_MODE_NONE;
+    uint32_t bestBits=nValues * 8;
+    uint32_t nBits;
+    if (nUniqueVals == 1)
+        nBits = (inVals[0] < 64) ? 8 : 10;
+    else if (nUniqueVals == 2)
+        nBits = nValues - 1 + 21;
+    else if (nUniqueVals <= 4)
+        nBits = (nValues - 1) * 2 + 6 + nUniqueVals * 8;
+    else if (nUniqueVals <= 8)
+        nBits = (nValues - 1) * 3 + 5 + nUniqueVals * 8;
+    else if (nUniqueVals <= MAX_UNIQUES)
+        nBits = (nValues - 1) * 4 + 8 + nUniqueVals * 8;
+    else
+        nBits = nValues * 8;
+    if ((nBits + 7) / 8 < nValues)
+    {
+        bestMode = FBC_MODE_FIXED_BIT;
+        bestBits = nBits;
+    }
+    nBits = (1 + nControlBytes + nValues - nTextChars + (nTextChars + 1) / 2) * 8;
+    if ((nBits < bestBits) && (nBits < nValues * 8))
+    {
+        bestMode = FBC_MODE_TEXT;
+        bestBits = nBits;
+    }
+    nBits = (1 + nControlBytes + 1 + nValues - val256[singleValue]) * 8;
+    if (nBits < bestBits)
+    {
+        bestMode = FBC_MODE_SINGLE_VALUE;
+        bestBits = nBits;
+    }
+    unsigned char compressedVals[3][MAX_FBC_BYTES*2]; // encoders may write past nValues before failing
+    const uint32_t encoderModes[3]={FBC_MODE_NIBBLE, FBC_MODE_FIXED_ALPHABET, FBC_MODE_FRAME_OF_REFERENCE};
+    int32_t encoderBits[3];
+    // nibble mode, hex chars included, needs at most two high nibbles, and fixed alphabets are ASCII
+    encoderBits[0] = (popcount64(highNibbleBits) <= 2) ? encodeNibbleMode(inVals, compressedVals[0], nValues, bestBits) : 0;
+    encoderBits[1] = ((highBitCheck & 0x80) == 0) ? encodeFixedAlphabet(inVals, compressedVals[1], nValues) : 0;
+    encoderBits[2] = (maxVal - minVal <= 127) ? encodeFrameOfReference(inVals, compressedVals[2], nValues) : 0;
+    uint32_t bestEncoder=3;
+    for (uint32_t i=0; i<3; i++)
+    {
+        if ((encoderBits[i] > 0) && ((uint32_t)encoderBits[i] < bestBits))
+        {
+            bestMode = encoderModes[i];
+            bestBits = (uint32_t)encoderBits[i];
+            bestEncoder = i;
+        }
+    }
+    nBits = (1 + (nValues / 8) * 7 + nValues % 8) * 8;
+    if (((highBitCheck & 0x80) == 0) && (nBits < bestBits))
+    {
+        bestMode = FBC_MODE_7BIT;
+        bestBits = nBits;
+    }
+
+    switch (bestMode)
+    {
+        case FBC_MODE_FIXED_BIT:
+            return encodeFixedBit(inVals, outVals, nValues, nUniqueVals, uniqueOccurrence);
+        case FBC_MODE_TEXT:
+            return encodeTextMode(inVals, outVals, nValues);
+        case FBC_MODE_SINGLE_VALUE:
+            return encodeSingleValueMode(inVals, outVals, nValues, (int32_t)singleValue);
+        case FBC_MODE_7BIT:
+            return encode7bits(inVals, outVals, nValues);
+        case FBC_MODE_NONE:
+            return 0; // no mode compresses
+        default:
+            memcpy(outVals, compressedVals[bestEncoder], (bestBits + 7) / 8);
+            return (int32_t)bestBits;
+    }
+} // end fbc264level
+
+// -----------------------------------------------------------------------------------
+// static Huffman mode
+// -----------------------------------------------------------------------------------
+// approximate count per 10000 chars of English text of each value for the built-in text table
+static const uint32_t huffmanTextCounts[256]={
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 3, 40, 1, 1, 10, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1700, 5, 25, 1, 1, 1, 1, 25, 4, 4, 1, 1, 110, 20, 100, 1,
+    8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 4, 4, 1, 1, 1, 6,
+    1, 40, 14, 18, 27, 85, 15, 13, 20, 50, 2, 5, 27, 16, 47, 51,
+    12, 2, 41, 25, 60, 19, 6, 18, 2, 11, 2, 1, 1, 1, 1, 1,
+    1, 650, 120, 220, 330, 1020, 180, 160, 490, 570, 10, 60, 330, 200, 570, 620,
+    150, 8, 500, 530, 740, 230, 80, 170, 12, 140, 6, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1
+};
+
+// count of each value for the built-in binary table, favoring zero, small values and 0xff
+static const uint32_t huffmanBinaryCounts[256]={
+    400, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24,
+    6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6,
+    10, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    10, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    10, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    10, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 60
+};
+
+// canonical Huffman code for all 256 values, built by fbcHuffmanTablesAdd
+struct fbcHuffman_s {
+    unsigned char lengths[256]; // code length of each value, 1 to HUFFMAN_MAX_BITS
+    uint16_t codes[256]; // code of each value, bit reversed to be output low bit first
+    uint32_t minLength; // shortest code length
+    // one or two values decoded from the next HUFFMAN_MAX_BITS bits: first value in bits 0-7,
+    // second in bits 8-15, code bits of both in 16-19, of the first in 20-23, values in 24-25
+    uint32_t decodeTable[1 << HUFFMAN_MAX_BITS];
+};
+
+// Huffman tables of a stream, the same for encoding and decoding, initialize with fbcHuffmanTablesInit
+struct fbcHuffmanTables_s {
+    struct fbcHuffman_s tables[HUFFMAN_TABLES];
+    uint32_t nTables;
+};
+
+// -----------------------------------------------------------------------------------
+static inline void huffmanLengths(const uint32_t *counts, unsigned char *lengths)
+// -----------------------------------------------------------------------------------
+{
+    // build Huffman code lengths giving every value a code, limited to HUFFMAN_MAX_BITS
+    uint64_t weights[511];
+    int32_t parents[511];
+    uint32_t nNodes=256;
+    for (uint32_t i=0; i<256; i++)
+    {
+        weights[i] = (uint64_t)counts[i] + 1;
+        parents[i] = -1;
+    }
+    while (nNodes < 511)
+    {
+        // merge the two lightest nodes without a parent
+        int32_t first=-1;
+        int32_t second=-1;
+        for (uint32_t i=0; i<nNodes; i++)
+        {
+            if (parents[i] >= 0)
+                continue;
+            if ((first < 0) || (weights[i] < weights[first]))
+            {
+                second = first;
+                first = (int32_t)i;
+            }
+            else if ((second < 0) || (weights[i] < weights[second]))
+                second = (int32_t)i;
+        }
+        weights[nNodes] = weights[first] + weights[second];
+        parents[nNodes] = -1;
+        parents[first] = (int32_t)nNodes;
+        parents[second] = (int32_t)nNodes;
+        nNodes++;
+    }
+    uint32_t kraft=0; // sum of 2^(HUFFMAN_MAX_BITS-length), 1 << HUFFMAN_MAX_BITS when complete
+    for (uint32_t i=0; i<256; i++)
+    {
+        uint32_t length=0;
+        for (int32_t node=(int32_t)i; parents[node] >= 0; node=parents[node])
+            length++;
+        lengths[i] = (unsigned char)((length > HUFFMAN_MAX_BITS) ? HUFFMAN_MAX_BITS : length);
+        kraft += 1 << (HUFFMAN_MAX_BITS - lengths[i]);
+    }
+    while (kraft > (1 << HUFFMAN_MAX_BITS))
+    {
+        // lengthen the code of the least frequent value with the longest code under the limit
+        int32_t best=-1;
+        for (uint32_t i=0; i<256; i++)
+        {
+            if ((lengths[i] < HUFFMAN_MAX_BITS) && ((best < 0) || (lengths[i] > lengths[best]) ||
+                ((lengths[i] == lengths[best]) && (counts[i] < counts[best]))))
+                best = (int32_t)i;
+        }
+        kraft -= 1 << (HUFFMAN_MAX_BITS - lengths[best] - 1);
+        lengths[best]++;
+    }
+    for (;;)
+    {
+        // shorten the code of the most frequent value that keeps the code valid
+        int32_t best=-1;
+        for (uint32_t i=0; i<256; i++)
+        {
+            if ((lengths[i] > 1) && (kraft + (1 << (HUFFMAN_MAX_BITS - lengths[i])) <= (1 << HUFFMAN_MAX_BITS)) &&
+                ((best < 0) || (counts[i] > counts[best])))
+                best = (int32_t)i;
+        }
+        if (best < 0)
+            break;
+        kraft += 1 << (HUFFMAN_MAX_BITS - lengths[best]);
+        lengths[best]--;
+    }
+} // end huffmanLengths
+
+// -----------------------------------------------------------------------------------
+static inline int32_t fbcHuffmanTablesAdd(struct fbcHuffmanTables_s *tables, const uint32_t *counts)
+// -----------------------------------------------------------------------------------
+// Add a table built from counts of each of 256 values, such as counts of training data.
+//    The encoder and decoder of a stream must add the same tables in the same order.
+// Returns the table id or -1 if HUFFMAN_TABLES tables have been added
+{
+    if (tables->nTables >= HUFFMAN_TABLES)
+        return -1;
+    struct fbcHuffman_s *huffman=&tables->tables[tables->nTables];
+    uint32_t nCodes[HUFFMAN_MAX_BITS+1];
+    uint32_t nextCode[HUFFMAN_MAX_BITS+1];
+    huffmanLengths(counts, huffman->lengths);
+    memset(nCodes, 0, sizeof(nCodes));
+    for (uint32_t i=0; i<256; i++)
+        nCodes[huffman->lengths[i]]++;
+    // canonical codes: codes of each length follow those of shorter lengths in value order
+    uint32_t code=0;
+    huffman->minLength = 0;
+    for (uint32_t length=1; length<=HUFFMAN_MAX_BITS; length++)
+    {
+        code = (code + nCodes[length-1]) << 1;
+        nextCode[length] = code;
+        if ((huffman->minLength == 0) && nCodes[length])
+            huffman->minLength = length;
+    }
+    for (uint32_t i=0; i<256; i++)
+    {
+        const uint32_t length=huffman->lengths[i];
+        const uint32_t valueCode=nextCode[length]++;
+        uint32_t reversedCode=0;
+        for (uint32_t bit=0; bit<length; bit++)
+            reversedCode |= ((valueCode >> bit) & 1) << (length - 1 - bit);
+        huffman->codes[i] = (uint16_t)reversedCode;
+    }
+    // fill every entry whose low bits are a code, then pair codes that fit together
+    for (uint32_t entry=0; entry<(1 << HUFFMAN_MAX_BITS); entry++)
+        huffman->decodeTable[entry] = 15 << 20; // longer than any code: invalid
+    for (uint32_t i=0; i<256; i++)
+    {
+        const uint32_t length=huffman->lengths[i];
+        for (uint32_t entry=huffman->codes[i]; entry<(1 << HUFFMAN_MAX_BITS); entry+=1 << length)
+            huffman->decodeTable[entry] = i | (length << 16) | (length << 20) | (1 << 24);
+    }
+    for (uint32_t entry=0; entry<(1 << HUFFMAN_MAX_BITS); entry++)
+    {
+        const uint32_t first=huffman->decodeTable[entry];
+        const uint32_t firstLength=(first >> 20) & 15;
+        if (firstLength >= HUFFMAN_MAX_BITS)
+            continue;
+        const uint32_t second=huffman->decodeTable[entry >> firstLength];
+        const uint32_t secondLength=(second >> 20) & 15;
+        if (firstLength + secondLength <= HUFFMAN_MAX_BITS)
+            huffman->decodeTable[entry] = (first & 0xff) | ((second & 0xff) << 8) | ((firstLength + secondLength) << 16) | (firstLength << 20) | (2 << 24);
+    }
+    return (int32_t)tables->nTables++;
+} // end fbcHuffmanTablesAdd
+
+// -----------------------------------------------------------------------------------
+static inline void fbcHuffmanTablesInit(struct fbcHuffmanTables_s *tables)
+// -----------------------------------------------------------------------------------
+// Initialize with the built-in tables HUFFMAN_TEXT_TABLE and HUFFMAN_BINARY_TABLE
+{
+    tables->nTables = 0;
+    fbcHuffmanTablesAdd(tables, huffmanTextCounts);
+    fbcHuffmanTablesAdd(tables, huffmanBinaryCounts);
+} // end fbcHuffmanTablesInit
+
+// -----------------------------------------------------------------------------------
+static inline int32_t fbc264huffman(const struct fbcHuffmanTables_s *tables, const unsigned char *inVals, unsigned char *outVals, const uint32_t nValues)
+// -----------------------------------------------------------------------------------
+// fbc264huffman: Compress nValues bytes as fbc264, or with the Huffman table of tables with the
+//    smallest output when that is smaller: 0xe0, the table id in the high 4 bits over
+//    EXTENDED_HUFFMAN_MODE, then the code of each value output low bit first.
+//    Decode with fbc264dhuffman and the same tables.
+// Arguments:
+//   tables   Huffman tables initialized by fbcHuffmanTablesInit
+//   inVals   input byte values
+//   outVals  output byte values if compressed, max of inVals bytes
+//   nValues  number of input byte values, 2 to 256; Huffman mode is for 6 to 64
+// Returns number of bits compressed, 0 if not compressed, or negative if error
+{
+    const int32_t nBits=fbc264(inVals, outVals, nValues);
+    if ((nBits < 0) || (nValues <= 5) || (nValues > MAX_FBC_BYTES))
+        return nBits;
+    uint32_t bestTable=0;
+    uint32_t bestBits=nBits ? (uint32_t)nBits : nValues * 8;
+    for (uint32_t t=0; t<tables->nTables; t++)
+    {
+        const unsigned char *lengths=tables->tables[t].lengths;
+        uint32_t nHuffmanBits=16;
+        for (uint32_t i=0; i<nValues; i++)
+            nHuffmanBits += lengths[inVals[i]];
+        if ((nHuffmanBits + 7) / 8 < (bestBits + 7) / 8)
+        {
+            bestTable = t + 1;
+            bestBits = nHuffmanBits;
+        }
+    }
+    if (bestTable == 0)
+        return nBits; // fbc264 output is smaller
+    const struct fbcHuffman_s *huffman=&tables->tables[bestTable-1];
+    outVals[0] = 0xe0; // indicate extended mode
+    outVals[1] = (unsigned char)(((bestTable - 1) << 4) | EXTENDED_HUFFMAN_MODE);
+    uint32_t nextOutVal=2;
+    uint64_t encodingBits=0;
+    uint32_t nEncodingBits=0;
+    for (uint32_t i=0; i<nValues; i++)
+    {
+        encodingBits |= (uint64_t)huffman->codes[inVals[i]] << nEncodingBits;
+        nEncodingBits += huffman->lengths[inVals[i]];
+        if (nEncodingBits >= 32)
+        {
+            outVals[nextOutVal++] = (unsigned char)encodingBits;
+            outVals[nextOutVal++] = (unsigned char)(encodingBits >> 8);
+            outVals[nextOutVal++] = (unsigned char)(encodingBits >> 16);
+            outVals[nextOutVal++] = (unsigned char)(encodingBits >> 24);
+            encodingBits >>= 32;
+            nEncodingBits -= 32;
+        }
+    }
+    while (nEncodingBits > 0)
+    {
+        outVals[nextOutVal++] = (unsigned char)encodingBits; // output last bytes
+        encodingBits >>= 8;
+        nEncodingBits = (nEncodingBits > 8) ? nEncodingBits - 8 : 0;
+    }
+    return (int32_t)bestBits;
+} // end fbc264huffman
+
+// -----------------------------------------------------------------------------------
+static inline int32_t decodeHuffman(const struct fbcHuffman_s *huffman, const unsigned char *inVals, unsigned char *outVals, const uint32_t nOriginalValues, uint32_t *bytesProcessed)
+// -----------------------------------------------------------------------------------
+{
+    // look up one or two values for the next HUFFMAN_MAX_BITS bits
+    // bytes are read ahead only when the remaining codes must fill them, so no byte past
+    // the block is read
+    const uint32_t mask=(1 << HUFFMAN_MAX_BITS) - 1;
+    uint64_t encodingBits=0;
+    uint32_t nEncodingBits=0;
+    uint32_t nextInVal=2;
+    uint32_t nextOutVal=0;
+    while (nextOutVal < nOriginalValues)
+    {
+        if ((nEncodingBits < HUFFMAN_MAX_BITS) && ((nOriginalValues - nextOutVal) * huffman->minLength >= 64))
+        {
+            while (nEncodingBits <= 56)
+            {
+                encodingBits |= (uint64_t)inVals[nextInVal++] << nEncodingBits;
+                nEncodingBits += 8;
+            }
+        }
+        const uint32_t entry=huffman->decodeTable[encodingBits & mask];
+        const uint32_t nPairBits=(entry >> 16) & 15;
+        if (((entry >> 24) == 2) && (nPairBits <= nEncodingBits) && (nextOutVal + 1 < nOriginalValues))
+        {
+            outVals[nextOutVal++] = (unsigned char)entry;
+            outVals[nextOutVal++] = (unsigned char)(entry >> 8);
+            encodingBits >>= nPairBits;
+            nEncodingBits -= nPairBits;
+            continue;
+        }
+        const uint32_t nFirstBits=(entry >> 20) & 15;
+        if (nFirstBits > nEncodingBits)
+        {
+            // code continues in the next byte
+            if (nEncodingBits >= HUFFMAN_MAX_BITS)
+                return -20; // invalid code
+            encodingBits |= (uint64_t)inVals[nextInVal++] << nEncodingBits;
+            nEncodingBits += 8;
+            continue;
+        }
+        outVals[nextOutVal++] = (unsigned char)entry;
+        encodingBits >>= nFirstBits;
+        nEncodingBits -= nFirstBits;
+    }
+    *bytesProcessed = nextInVal - nEncodingBits / 8; // less whole bytes read but not used
+    return (int32_t)nOriginalValues;
+} // end decodeHuffman
+
+// -----------------------------------------------------------------------------------
+static inline int32_t fbc264dhuffman(const struct fbcHuffmanTables_s *tables, const unsigned char *inVals, unsigned char *outVals, const uint32_t nOriginalValues, uint32_t *bytesProcessed)
+// -----------------------------------------------------------------------------------
+// Decode a block encoded by fbc264huffman with the same tables.
+// Returns number of bytes output or negative if error
+{
+    if ((nOriginalValues > 5) && (nOriginalValues <= MAX_FBC_BYTES) && (inVals[0] == 0xe0) && ((inVals[1] & 0xf) == EXTENDED_HUFFMAN_MODE))
+    {
+        if ((uint32_t)(inVals[1] >> 4) >= tables->nTables)
+            return -19; // table not in tables
+        return decodeHuffman(&tables->tables[inVals[1] >> 4], inVals, outVals, nOriginalValues, bytesProcessed);
+    }
+    return fbc264d(inVals, outVals, nOriginalValues, bytesProcessed);
+} // end fbc264dhuffman
+
+// -----------------------------------------------------------------------------------
+// fast decoding with slack bytes
+// -----------------------------------------------------------------------------------
+
+// -----------------------------------------------------------------------------------
+static inline int32_t fbc264dfast(const unsigned char *inVals, unsigned char *outVals, const uint32_t nOriginalValues, uint32_t *bytesProcessed)
+// -----------------------------------------------------------------------------------
+// fbc264dfast: Decode a block as fbc264d. Blocks of 2 uniques are decoded 8 values at a time
+//    into one 64-bit word, so the last word may write up to 7 bytes past nOriginalValues. The
+//    output buffer must have FBC_SLACK_BYTES after it, as where blocks are decoded back to back
+//    in large buffers. Other blocks are decoded by fbc264d, as wider codes are bound by the
+//    lookup of each unique rather than the end of block checks.
+// Returns number of bytes output or negative if error
+{
+    if ((nOriginalValues <= 5) || (nOriginalValues > MAX_FBC_LARGE_BYTES) || ((inVals[0] & 0x1f) != 2))
+        return fbc264d(inVals, outVals, nOriginalValues, bytesProcessed); // not 2 uniques
+    // 1-bit values, 8 per byte after the 3 in the first byte
+    // spread the 8 bits to the high bit of each byte and select the second unique where set
+    const unsigned char firstByte=inVals[0];
+    const uint64_t firstWord=inVals[1] * (uint64_t)0x0101010101010101;
+    const uint64_t diffWord=(inVals[1] ^ inVals[2]) * (uint64_t)0x0101010101010101;
+    uint64_t outWord;
+    uint32_t nextInVal=3;
+    outVals[0] = inVals[1];
+    outVals[1] = inVals[1 + ((firstByte >> 5) & 1)];
+    outVals[2] = inVals[1 + ((firstByte >> 6) & 1)];
+    outVals[3] = inVals[1 + (firstByte >> 7)];
+    for (uint32_t nextOutVal=4; nextOutVal<nOriginalValues; nextOutVal+=8)
+    {
+        uint64_t bits=(inVals[nextInVal++] * (uint64_t)0x0101010101010101) & 0x8040201008040201;
+        bits = ((bits + 0x7f7f7f7f7f7f7f7f) | bits) & 0x8080808080808080;
+        outWord = firstWord ^ (((bits >> 7) * 0xff) & diffWord);
+        memcpy(outVals+nextOutVal, &outWord, 8);
+    }
+    *bytesProcessed = nextInVal;
+    return (int32_t)nOriginalValues;
+} // end fbc264dfast
+
+// -----------------------------------------------------------------------------------
+// in-place stream decoding
+// -----------------------------------------------------------------------------------
+
+// -----------------------------------------------------------------------------------
+static inline uint64_t fbcInPlaceBound(const uint64_t nOriginalBytes, const uint32_t blockSize)
+// -----------------------------------------------------------------------------------
+// Return the buffer size for fbcStreamDecodeInPlace of a stream of nOriginalBytes values
+{
+    // Compressed blocks save bytes and uncompressed blocks save none, so the bytes saved before
+    //    a block never exceed those saved by the whole stream. With the stream at the end of the
+    //    buffer, output is then at least one block behind input when a block is decoded.
+    return nOriginalBytes + blockSize;
+} // end fbcInPlaceBound
+
+// -----------------------------------------------------------------------------------
+static inline int64_t fbcStreamDecodeInPlace(unsigned char *buffer, const uint64_t bufferSize, const uint64_t nInBytes, const uint64_t *compressedBits, const uint32_t blockSize)
+// -----------------------------------------------------------------------------------
+// Decode a stream of blocks held at the end of buffer into the start of the same buffer,
+//    block by block front to back. The stream is the output of the main.c test bed, as for
+//    fbcStreamHistogram. Before each block the output is checked to end at or before the
+//    block's input, so no input is overwritten before it is read.
+// Arguments:
+//   buffer          buffer with the stream in its last nInBytes bytes
+//   bufferSize      bytes in buffer, fbcInPlaceBound of the decoded bytes or more
+//   nInBytes        number of bytes in compressed stream
+//   compressedBits  one bit per block, from the high bit of each 64-bit word, 1 if compressed
+//   blockSize       number of values in each block, 2 to 256
+// Returns number of bytes output, -16 if a block extends past end of input, -21 if the
+//    buffer is too small to decode in place, or other negative if error
+{
+    uint64_t nextInVal;
+    uint64_t nextOutVal=0;
+    uint64_t block=0;
+    uint32_t bytesProcessed;
+    if ((blockSize < MIN_FBC_BYTES) || (blockSize > MAX_FBC_LARGE_BYTES) || (nInBytes > bufferSize))
+        return -1;
+    nextInVal = bufferSize - nInBytes;
+    while (nextInVal < bufferSize)
+    {
+        if (nextOutVal + blockSize > nextInVal)
+            return -21; // output would overwrite unread input
+        if ((compressedBits[block / 64] << (block % 64)) & 0x8000000000000000)
+        {
+            const int32_t ret=fbc264d(buffer+nextInVal, buffer+nextOutVal, blockSize, &bytesProcessed);
+            if (ret < 0)
+                return ret;
+            if (nextInVal + bytesProcessed > bufferSize)
+                return -16; // block extends past end of input
+            nextInVal += bytesProcessed;
+            nextOutVal += blockSize;
+        }
+        else
+        {
+            // uncompressed block, shorter if last in stream
+            const uint64_t nBlockValues=(bufferSize - nextInVal < blockSize) ? bufferSize - nextInVal : blockSize;
+            memcpy(buffer+nextOutVal, buffer+nextInVal, nBlockValues);
+            nextInVal += nBlockValues;
+            nextOutVal += nBlockValues;
+        }
+        block++;
+    }
+    return (int64_t)nextOutVal;
+} // end fbcStreamDecodeInPlace
+
+// -----------------------------------------------------------------------------------
+// whole-buffer compression
+// -----------------------------------------------------------------------------------
+
+// -----------------------------------------------------------------------------------
+static inline uint64_t fbcCompressBound(const uint64_t nBytes, const uint32_t blockSize)
+// -----------------------------------------------------------------------------------
+// Return max number of bytes output by fbcCompressBuffer for nBytes with blocks of blockSize values
+{
+    // header, a compressed or not bit for each block including the last partial block, and
+    //    the input, as blocks are compressed only when that saves bytes
+    return FBC_BUFFER_HEADER_BYTES + (nBytes / blockSize + 8) / 8 + nBytes;
+} // end fbcCompressBound
+
+// -----------------------------------------------------------------------------------
+static inline int64_t fbcCompressBuffer(const unsigned char *inVals, const uint64_t nInBytes, unsigned char *outVals, const uint64_t nOutBytes, const uint32_t blockSize)
+// -----------------------------------------------------------------------------------
+// fbcCompressBuffer: Compress nInBytes values as blocks of blockSize values by fbc25 or fbc264,
+//    each stored as is when it does not compress, into one stream decoded by fbcDecompressBuffer:
+//    1. the original size in 7-bit groups with the high bit set when another byte follows
+//    2. the block size, with 256 as 0
+//    3. one bit per block, from the high bit of each byte, 1 if compressed; a final block of
+//       fewer than blockSize values is stored as is
+//    4. the compressed or original bytes of each block
+//    There is no state outside the arguments and no allocation, so threads may compress at once.
+// Arguments:
+//   inVals     input byte values
+//   nInBytes   number of input byte values
+//   outVals    output stream
+//   nOutBytes  bytes in outVals, at least fbcCompressBound of nInBytes
+//   blockSize  number of values in each block, 2 to 256
+// Returns number of bytes output, -1 if blockSize is out of range or -22 if nOutBytes is too small
+{
+    if ((blockSize < MIN_FBC_BYTES) || (blockSize > MAX_FBC_LARGE_BYTES))
+        return -1;
+    if (nOutBytes < fbcCompressBound(nInBytes, blockSize))
+        return -22; // output smaller than fbcCompressBound
+    uint64_t nextOutVal=0;
+    uint64_t size=nInBytes;
+    while (size >= 0x80)
+    {
+        outVals[nextOutVal++] = (unsigned char)(size | 0x80);
+        size >>= 7;
+    }
+    outVals[nextOutVal++] = (unsigned char)size;
+    outVals[nextOutVal++] = (unsigned char)blockSize; // block size of 256 is written as 0
+    const uint64_t nBitsBytes=((nInBytes + blockSize - 1) / blockSize + 7) / 8;
+    unsigned char *compressedBits=outVals+nextOutVal;
+    memset(compressedBits, 0, nBitsBytes);
+    nextOutVal += nBitsBytes;
+    uint64_t nextInVal=0;
+    for (uint64_t block=0; nextInVal+blockSize<=nInBytes; block++)
+    {
+        // encoders may write past blockSize before failing, so near the end of output
+        //    blocks are compressed into a local buffer
+        unsigned char localVals[MAX_FBC_LARGE_BYTES*2];
+        unsigned char *pOutVals=(nOutBytes - nextOutVal >= blockSize * 2) ? outVals+nextOutVal : localVals;
+        int32_t nBits;
+        if (blockSize < 6)
+            nBits = fbc25(inVals+nextInVal, pOutVals, blockSize);
+        else
+            nBits = fbc264(inVals+nextInVal, pOutVals, blockSize);
+        const uint32_t nBlockBytes=(nBits > 0) ? ((uint32_t)nBits + 7) / 8 : blockSize;
+        if (nBlockBytes < blockSize)
+        {
+            compressedBits[block / 8] |= (unsigned char)(0x80 >> (block % 8));
+            if (pOutVals == localVals)
+                memcpy(outVals+nextOutVal, localVals, nBlockBytes);
+            nextOutVal += nBlockBytes;
+        }
+        else
+        {
+            memcpy(outVals+nextOutVal, inVals+nextInVal, blockSize);
+            nextOutVal += blockSize;
+        }
+        nextInVal += blockSize;
+    }
+    memcpy(outVals+nextOutVal, inVals+nextInVal, nInBytes - nextInVal); // last partial block
+    nextOutVal += nInBytes - nextInVal;
+    return (int64_t)nextOutVal;
+} // end fbcCompressBuffer
+
+// -----------------------------------------------------------------------------------
+static inline int32_t readBufferHeader(const unsigned char *inVals, const uint64_t nInBytes, uint64_t *nOriginalBytes, uint32_t *blockSize)
+// -----------------------------------------------------------------------------------
+{
+    // read the original size and block size output by fbcCompressBuffer
+    // return the number of header bytes or -15 if the header is incomplete or invalid
+    uint64_t size=0;
+    uint32_t shift=0;
+    uint32_t nextInVal=0;
+    do
+    {
+        if ((nextInVal >= nInBytes) || (shift > 63))
+            return -15; // incomplete or invalid header
+        size |= (uint64_t)(inVals[nextInVal] & 0x7f) << shift;
+        shift += 7;
+    } while (inVals[nextInVal++] & 0x80);
+    if (nextInVal >= nInBytes)
+        return -15; // incomplete header
+    *nOriginalBytes = size;
+    *blockSize = inVals[nextInVal++];
+    if (*blockSize == 0)
+        *blockSize = 256;
+    if (*blockSize < MIN_FBC_BYTES)
+        return -15; // invalid block size
+    return (int32_t)nextInVal;
+} // end readBufferHeader
+
+// -----------------------------------------------------------------------------------
+static inline int64_t fbcDecompressedSize(const unsigned char *inVals, const uint64_t nInBytes)
+// -----------------------------------------------------------------------------------
+// Return the original size of a stream output by fbcCompressBuffer or -15 if its header is invalid
+{
+    uint64_t nOriginalBytes;
+    uint32_t blockSize;
+    const int32_t nHeaderBytes=readBufferHeader(inVals, nInBytes, &nOriginalBytes, &blockSize);
+    if (nHeaderBytes < 0)
+        return nHeaderBytes;
+    return (int64_t)nOriginalBytes;
+} // end fbcDecompressedSize
+
+// -----------------------------------------------------------------------------------
+static inline int64_t fbcDecompressBuffer(const unsigned char *inVals, const uint64_t nInBytes, unsigned char *outVals, const uint64_t nOutBytes)
+// -----------------------------------------------------------------------------------
+// Decode a stream output by fbcCompressBuffer. Blocks are decoded by fbc264dfast while
+//    FBC_SLACK_BYTES remain after them in outVals, and by fbc264d near its end.
+//    There is no state outside the arguments and no allocation, so threads may decode at once.
+// Arguments:
+//   inVals     stream output by fbcCompressBuffer
+//   nInBytes   number of bytes in stream
+//   outVals    output with room for fbcDecompressedSize bytes
+//   nOutBytes  bytes in outVals
+// Returns number of bytes output, -15 if the header is invalid, -16 if a block extends past
+//    end of input, -22 if nOutBytes is too small, or other negative if error
+{
+    uint64_t nOriginalBytes;
+    uint32_t blockSize;
+    uint32_t bytesProcessed;
+    const int32_t nHeaderBytes=readBufferHeader(inVals, nInBytes, &nOriginalBytes, &blockSize);
+    if (nHeaderBytes < 0)
+        return nHeaderBytes;
+    if (nOriginalBytes > nOutBytes)
+        return -22; // output smaller than original size
+    const unsigned char *compressedBits=inVals+nHeaderBytes;
+    uint64_t nextInVal=(uint64_t)nHeaderBytes + ((nOriginalBytes + blockSize - 1) / blockSize + 7) / 8;
+    uint64_t nextOutVal=0;
+    if (nextInVal > nInBytes)
+        return -16; // compressed or not bits extend past end of input
+    for (uint64_t block=0; nextOutVal+blockSize<=nOriginalBytes; block++)
+    {
+        if ((compressedBits[block / 8] << (block % 8)) & 0x80)
+        {
+            const unsigned char *pInVals=inVals+nextInVal;
+            unsigned char localVals[MAX_FBC_LARGE_BYTES*2];
+            if (nInBytes - nextInVal < blockSize + 64)
+            {
+                // near the end of input, decode from a zero-padded copy so that a block cut
+                //    short or invalid is not read past the end of input
+                memset(localVals, 0, sizeof(localVals));
+                memcpy(localVals, inVals+nextInVal, nInBytes - nextInVal);
+                pInVals = localVals;
+            }
+            int32_t ret;
+            if (nOutBytes - nextOutVal >= blockSize + FBC_SLACK_BYTES)
+                ret = fbc264dfast(pInVals, outVals+nextOutVal, blockSize, &bytesProcessed);
+            else
+                ret = fbc264d(pInVals, outVals+nextOutVal, blockSize, &bytesProcessed);
+            if (ret < 0)
+                return ret;
+            if (nextInVal + bytesProcessed > nInBytes)
+                return -16; // block extends past end of input
+            nextInVal += bytesProcessed;
+        }
+        else
+        {
+            if (nextInVal + blockSize > nInBytes)
+                return -16; // block extends past end of input
+            memcpy(outVals+nextOutVal, inVals+nextInVal, blockSize);
+            nextInVal += blockSize;
+        }
+        nextOutVal += blockSize;
+    }
+    if (nextInVal + nOriginalBytes - nextOutVal > nInBytes)
+        return -16; // last block extends past end of input
+    memcpy(outVals+nextOutVal, inVals+nextInVal, nOriginalBytes - nextOutVal); // last partial block
+    return (int64_t)nOriginalBytes;
+} // end fbcDecompressBuffer
+
+#endif /* fbc_h */
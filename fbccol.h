@@ -0,0 +1,249 @@
+//
+//  fbccol.h
+//  column of short strings compressed by fixed bit coding with random access
+//
+//  Copyright © 2020 L. Stevan Leonard. All rights reserved.
+/*
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.//
+*/
+// Values of 0 to 64 bytes are appended to a column and read back by index. Values of 2 to 64
+// bytes are compressed by fbc25 or fbc264 when that saves at least one byte. Stored bytes are
+// packed back to back in an arena, with an offsets array giving the start of each value's
+// stored bytes, a length array giving each value's uncompressed length, and a bit per value
+// set when it is compressed. The arena and arrays grow by doubling, so there is no allocation
+// per value. Each value costs its stored bytes plus 5 bytes and 1 bit of index.
+
+#ifndef fbccol_h
+#define fbccol_h
+
+#include "fbc.h"
+
+struct fbcColumn_s {
+    unsigned char *arena; // stored bytes of all values back to back
+    uint64_t arenaSize;
+    uint32_t *offsets; // nValues+1 arena offsets, value i stored from offsets[i] to offsets[i+1]
+    unsigned char *lengths; // uncompressed length of each value
+    uint64_t *compressedBits; // bit i set when value i is compressed
+    uint64_t nValues;
+    uint64_t maxValues; // capacity of offsets, lengths and compressedBits
+    uint32_t compress; // 0 to store all values uncompressed
+};
+
+// -----------------------------------------------------------------------------------
+static inline void fbcColumnFree(struct fbcColumn_s *col)
+// -----------------------------------------------------------------------------------
+{
+    free(col->arena);
+    free(col->offsets);
+    free(col->lengths);
+    free(col->compressedBits);
+    memset(col, 0, sizeof(struct fbcColumn_s));
+} // end fbcColumnFree
+
+// -----------------------------------------------------------------------------------
+static inline int32_t columnReserveValues(struct fbcColumn_s *col, const uint64_t nMoreValues)
+// -----------------------------------------------------------------------------------
+{
+    // grow index arrays to hold nMoreValues more values
+    if (col->nValues + nMoreValues <= col->maxValues)
+        return 0;
+    uint64_t maxValues=col->maxValues * 2;
+    if (maxValues < col->nValues + nMoreValues)
+        maxValues = col->nValues + nMoreValues;
+    const uint64_t nWords=(maxValues + 63) / 64;
+    uint32_t *offsets=(uint32_t *)realloc(col->offsets, (maxValues + 1) * sizeof(uint32_t));
+    if (offsets == NULL)
+        return -3; // out of memory
+    col->offsets = offsets;
+    unsigned char *lengths=(unsigned char *)realloc(col->lengths, maxValues);
+    if (lengths == NULL)
+        return -3; // out of memory
+    col->lengths = lengths;
+    uint64_t *compressedBits=(uint64_t *)realloc(col->compressedBits, nWords * sizeof(uint64_t));
+    if (compressedBits == NULL)
+        return -3; // out of memory
+    const uint64_t nOldWords=(col->maxValues + 63) / 64;
+    memset(compressedBits+nOldWords, 0, (nWords - nOldWords) * sizeof(uint64_t));
+    col->compressedBits = compressedBits;
+    col->maxValues = maxValues;
+    return 0;
+} // end columnReserveValues
+
+// -----------------------------------------------------------------------------------
+static inline int32_t columnReserveBytes(struct fbcColumn_s *col, const uint64_t nMoreBytes)
+// -----------------------------------------------------------------------------------
+{
+    // grow the arena to hold nMoreBytes more stored bytes
+    const uint64_t arenaUsed=col->offsets[col->nValues];
+    if (arenaUsed + nMoreBytes <= col->arenaSize)
+        return 0;
+    uint64_t arenaSize=col->arenaSize * 2;
+    if (arenaSize < arenaUsed + nMoreBytes)
+        arenaSize = arenaUsed + nMoreBytes;
+    if (arenaSize > 0xffffffff)
+        arenaSize = 0xffffffff;
+    if (arenaUsed + nMoreBytes > arenaSize)
+        return -4; // arena full
+    unsigned char *arena=(unsigned char *)realloc(col->arena, arenaSize);
+    if (arena == NULL)
+        return -3; // out of memory
+    col->arena = arena;
+    col->arenaSize = arenaSize;
+    return 0;
+} // end columnReserveBytes
+
+// -----------------------------------------------------------------------------------
+static inline int32_t fbcColumnInit(struct fbcColumn_s *col, const uint64_t nExpectedValues, const uint64_t nExpectedBytes, const uint32_t compress)
+// -----------------------------------------------------------------------------------
+// Allocate a column sized for nExpectedValues values with nExpectedBytes stored bytes.
+// Set compress to 0 to store values uncompressed.
+// Returns 0 or -3 if out of memory
+{
+    memset(col, 0, sizeof(struct fbcColumn_s));
+    col->compress = compress;
+    col->offsets = (uint32_t *)malloc(sizeof(uint32_t));
+    if (col->offsets == NULL)
+        return -3; // out of memory
+    col->offsets[0] = 0;
+    if ((columnReserveValues(col, nExpectedValues ? nExpectedValues : 64) < 0) ||
+        (columnReserveBytes(col, nExpectedBytes + MAX_FBC_BYTES*2) < 0))
+    {
+        fbcColumnFree(col);
+        return -3; // out of memory
+    }
+    return 0;
+} // end fbcColumnInit
+
+// -----------------------------------------------------------------------------------
+static inline uint64_t fbcColumnMemory(const struct fbcColumn_s *col)
+// -----------------------------------------------------------------------------------
+// Return bytes used by stored values and the index of nValues values
+{
+    return col->offsets[col->nValues] + col->nValues * (sizeof(uint32_t) + 1) + (col->nValues + 63) / 64 * sizeof(uint64_t);
+} // end fbcColumnMemory
+
+// -----------------------------------------------------------------------------------
+static inline int32_t fbcColumnAppend(struct fbcColumn_s *col, const unsigned char *inVals, const uint32_t nValues)
+// -----------------------------------------------------------------------------------
+// Append a value of nValues bytes of 0 to 64 to the column.
+// Returns 0, -2 if nValues out of range, -3 if out of memory or -4 if arena is full
+{
+    if (nValues > MAX_FBC_BYTES)
+        return -2; // values over 64 bytes not supported
+    int32_t ret;
+    // encoders may write past nValues before failing, so reserve room for 128 bytes
+    if (((ret=columnReserveValues(col, 1)) < 0) || ((ret=columnReserveBytes(col, MAX_FBC_BYTES*2)) < 0))
+        return ret;
+    const uint64_t i=col->nValues;
+    unsigned char *pStoredVals=col->arena + col->offsets[i];
+    uint32_t nBytes=nValues;
+    uint64_t compressedBit=0;
+    if (col->compress && (nValues >= MIN_FBC_BYTES))
+    {
+        const int32_t nBits=fbc264(inVals, pStoredVals, nValues); // calls fbc25 for 5 or fewer
+        if ((nBits > 0) && (((uint32_t)nBits + 7) / 8 < nValues))
+        {
+            nBytes = ((uint32_t)nBits + 7) / 8;
+            compressedBit = 1;
+        }
+    }
+    if (!compressedBit)
+        memcpy(pStoredVals, inVals, nValues);
+    col->compressedBits[i / 64] = (col->compressedBits[i / 64] & ~((uint64_t)1 << (i % 64))) | (compressedBit << (i % 64));
+    col->lengths[i] = (unsigned char)nValues;
+    col->offsets[i+1] = col->offsets[i] + nBytes;
+    col->nValues = i + 1;
+    return 0;
+} // end fbcColumnAppend
+
+// -----------------------------------------------------------------------------------
+static inline int32_t fbcColumnAppendBulk(struct fbcColumn_s *col, const unsigned char * const *valueVals, const uint32_t *valueLengths, const uint64_t nAppendValues)
+// -----------------------------------------------------------------------------------
+// Append nAppendValues values, value i of valueLengths[i] bytes at valueVals[i].
+// Returns 0 or the negative return of fbcColumnAppend for the first value that failed,
+//    with the values before it appended
+{
+    int32_t ret;
+    uint64_t nAppendBytes=0;
+    for (uint64_t i=0; i<nAppendValues; i++)
+        nAppendBytes += valueLengths[i];
+    // reserve once for all values, or as much as fits in the arena
+    if ((ret=columnReserveValues(col, nAppendValues)) < 0)
+        return ret;
+    if (columnReserveBytes(col, nAppendBytes + MAX_FBC_BYTES*2) == -3)
+        return -3; // out of memory
+    for (uint64_t i=0; i<nAppendValues; i++)
+    {
+        if ((ret=fbcColumnAppend(col, valueVals[i], valueLengths[i])) < 0)
+            return ret;
+    }
+    return 0;
+} // end fbcColumnAppendBulk
+
+// -----------------------------------------------------------------------------------
+static inline int32_t fbcColumnLength(const struct fbcColumn_s *col, const uint64_t index)
+// -----------------------------------------------------------------------------------
+// Returns the length of value index or -1 if index is out of range
+{
+    if (index >= col->nValues)
+        return -1; // index out of range
+    return col->lengths[index];
+} // end fbcColumnLength
+
+// -----------------------------------------------------------------------------------
+static inline int32_t fbcColumnGet(const struct fbcColumn_s *col, const uint64_t index, unsigned char *outVals)
+// -----------------------------------------------------------------------------------
+// Decode value index into outVals, which must have room for its length.
+// Returns number of bytes output, -1 if index is out of range or other negative if error
+{
+    if (index >= col->nValues)
+        return -1; // index out of range
+    const uint32_t nValues=col->lengths[index];
+    const unsigned char *pStoredVals=col->arena + col->offsets[index];
+    if ((col->compressedBits[index / 64] >> (index % 64)) & 1)
+    {
+        uint32_t bytesProcessed;
+        return fbc264d(pStoredVals, outVals, nValues, &bytesProcessed);
+    }
+    memcpy(outVals, pStoredVals, nValues);
+    return (int32_t)nValues;
+} // end fbcColumnGet
+
+// -----------------------------------------------------------------------------------
+static inline int64_t fbcColumnDecode(const struct fbcColumn_s *col, const uint64_t firstIndex, const uint64_t nDecodeValues, unsigned char *outVals, uint64_t *outOffsets)
+// -----------------------------------------------------------------------------------
+// Decode nDecodeValues values starting at firstIndex back to back into outVals.
+// Arguments:
+//   outVals     output with room for the sum of the lengths of the values
+//   outOffsets  if not NULL, gets nDecodeValues+1 offsets of each value in outVals
+// Returns number of bytes output, -1 if the values are out of range or other negative if error
+{
+    if ((firstIndex > col->nValues) || (nDecodeValues > col->nValues - firstIndex))
+        return -1; // index out of range
+    uint64_t nOut=0;
+    for (uint64_t i=firstIndex; i<firstIndex+nDecodeValues; i++)
+    {
+        if (outOffsets != NULL)
+            *(outOffsets++) = nOut;
+        const int32_t nBytes=fbcColumnGet(col, i, outVals+nOut);
+        if (nBytes < 0)
+            return nBytes;
+        nOut += (uint32_t)nBytes;
+    }
+    if (outOffsets != NULL)
+        *outOffsets = nOut;
+    return (int64_t)nOut;
+} // end fbcColumnDecode
+
+#endif /* fbccol_h */
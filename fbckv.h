@@ -0,0 +1,303 @@
+//
+//  fbckv.h
+//  in-memory key-value store of small values compressed by fixed bit coding
+//
+//  Copyright © 2020 L. Stevan Leonard. All rights reserved.
+/*
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.//
+*/
+// Values of 0 to 64 bytes are stored under 64-bit keys in an open addressing hash table
+// with linear probing. Each entry holds the key, the uncompressed length, the number of
+// stored bytes and whether they are compressed. Values of 2 to 64 bytes are compressed
+// by fbc25 or fbc264 when that saves at least one byte. Stored bytes of 4 or fewer are kept
+// in the entry; otherwise they are kept in an arena that grows as needed, with a free list
+// for each stored size so that replaced and removed values are reused.
+
+#ifndef fbckv_h
+#define fbckv_h
+
+#include "fbc.h"
+
+#define FBCKV_INLINE_BYTES 4 // stored bytes kept in the entry instead of the arena
+#define FBCKV_NO_OFFSET 0xffffffff // end of free list
+#define FBCKV_EMPTY 0 // entry states
+#define FBCKV_RAW 1
+#define FBCKV_COMPRESSED 2
+
+struct fbcKVEntry_s {
+    uint64_t key;
+    uint32_t offset; // arena offset of stored bytes, or the stored bytes if FBCKV_INLINE_BYTES or fewer
+    unsigned char nValues; // uncompressed length
+    unsigned char nBytes; // stored length
+    unsigned char state; // FBCKV_EMPTY, FBCKV_RAW or FBCKV_COMPRESSED
+    unsigned char reserved;
+};
+
+struct fbcKV_s {
+    struct fbcKVEntry_s *entries;
+    uint64_t tableSize; // power of 2
+    uint64_t nEntries;
+    unsigned char *arena;
+    uint64_t arenaSize;
+    uint64_t arenaUsed;
+    uint32_t freeLists[MAX_FBC_BYTES+1]; // first free arena offset by stored size
+    uint32_t compress; // 0 to store all values uncompressed
+};
+
+// -----------------------------------------------------------------------------------
+static inline int32_t fbcKVInit(struct fbcKV_s *kv, uint64_t nExpectedEntries, const uint32_t compress)
+// -----------------------------------------------------------------------------------
+// Allocate a store sized for nExpectedEntries. Set compress to 0 to store values uncompressed.
+// Returns 0 or -3 if out of memory
+{
+    uint64_t tableSize=16;
+    while (tableSize * 3 / 4 < nExpectedEntries)
+        tableSize <<= 1;
+    memset(kv, 0, sizeof(struct fbcKV_s));
+    kv->entries = (struct fbcKVEntry_s *)calloc(tableSize, sizeof(struct fbcKVEntry_s));
+    kv->arenaSize = nExpectedEntries * 16 + 4096;
+    kv->arena = (unsigned char *)malloc(kv->arenaSize);
+    if ((kv->entries == NULL) || (kv->arena == NULL))
+    {
+        free(kv->entries);
+        free(kv->arena);
+        return -3; // out of memory
+    }
+    kv->tableSize = tableSize;
+    kv->compress = compress;
+    for (uint32_t i=0; i<=MAX_FBC_BYTES; i++)
+        kv->freeLists[i] = FBCKV_NO_OFFSET;
+    return 0;
+} // end fbcKVInit
+
+// -----------------------------------------------------------------------------------
+static inline void fbcKVFree(struct fbcKV_s *kv)
+// -----------------------------------------------------------------------------------
+{
+    free(kv->entries);
+    free(kv->arena);
+    memset(kv, 0, sizeof(struct fbcKV_s));
+} // end fbcKVFree
+
+// -----------------------------------------------------------------------------------
+static inline uint64_t fbcKVMemory(const struct fbcKV_s *kv)
+// -----------------------------------------------------------------------------------
+// Return bytes used by the hash table and the used part of the arena
+{
+    return kv->tableSize * sizeof(struct fbcKVEntry_s) + kv->arenaUsed;
+} // end fbcKVMemory
+
+// -----------------------------------------------------------------------------------
+static inline uint64_t kvSlot(const struct fbcKV_s *kv, const uint64_t key)
+// -----------------------------------------------------------------------------------
+{
+    return ((key * 0x9e3779b97f4a7c15) >> 32) & (kv->tableSize - 1);
+} // end kvSlot
+
+// -----------------------------------------------------------------------------------
+static inline void kvFreeBytes(struct fbcKV_s *kv, const struct fbcKVEntry_s *entry)
+// -----------------------------------------------------------------------------------
+{
+    // push arena bytes of entry on free list for its size
+    if (entry->nBytes <= FBCKV_INLINE_BYTES)
+        return;
+    memcpy(kv->arena + entry->offset, &kv->freeLists[entry->nBytes], sizeof(uint32_t));
+    kv->freeLists[entry->nBytes] = entry->offset;
+} // end kvFreeBytes
+
+// -----------------------------------------------------------------------------------
+static inline int32_t kvAllocBytes(struct fbcKV_s *kv, const uint32_t nBytes, uint32_t *offset)
+// -----------------------------------------------------------------------------------
+{
+    // pop free list for nBytes or take bytes from end of arena, growing as needed
+    if (kv->freeLists[nBytes] != FBCKV_NO_OFFSET)
+    {
+        *offset = kv->freeLists[nBytes];
+        memcpy(&kv->freeLists[nBytes], kv->arena + *offset, sizeof(uint32_t));
+        return 0;
+    }
+    if (kv->arenaUsed + nBytes > kv->arenaSize)
+    {
+        uint64_t arenaSize=kv->arenaSize * 2;
+        if (arenaSize > FBCKV_NO_OFFSET)
+            arenaSize = FBCKV_NO_OFFSET;
+        if (kv->arenaUsed + nBytes > arenaSize)
+            return -4; // arena full
+        unsigned char *arena=(unsigned char *)realloc(kv->arena, arenaSize);
+        if (arena == NULL)
+            return -3; // out of memory
+        kv->arena = arena;
+        kv->arenaSize = arenaSize;
+    }
+    *offset = (uint32_t)kv->arenaUsed;
+    kv->arenaUsed += nBytes;
+    return 0;
+} // end kvAllocBytes
+
+// -----------------------------------------------------------------------------------
+static inline int32_t kvGrow(struct fbcKV_s *kv)
+// -----------------------------------------------------------------------------------
+{
+    // double the hash table and reinsert entries
+    const uint64_t oldTableSize=kv->tableSize;
+    struct fbcKVEntry_s *oldEntries=kv->entries;
+    struct fbcKVEntry_s *entries=(struct fbcKVEntry_s *)calloc(oldTableSize * 2, sizeof(struct fbcKVEntry_s));
+    if (entries == NULL)
+        return -3; // out of memory
+    kv->entries = entries;
+    kv->tableSize = oldTableSize * 2;
+    for (uint64_t i=0; i<oldTableSize; i++)
+    {
+        if (oldEntries[i].state == FBCKV_EMPTY)
+            continue;
+        uint64_t slot=kvSlot(kv, oldEntries[i].key);
+        while (entries[slot].state != FBCKV_EMPTY)
+            slot = (slot + 1) & (kv->tableSize - 1);
+        entries[slot] = oldEntries[i];
+    }
+    free(oldEntries);
+    return 0;
+} // end kvGrow
+
+// -----------------------------------------------------------------------------------
+static inline int32_t fbcKVPut(struct fbcKV_s *kv, const uint64_t key, const unsigned char *inVals, const uint32_t nValues)
+// -----------------------------------------------------------------------------------
+// Store nValues bytes of 0 to 64 under key, replacing any value stored for key.
+// Returns 0, -2 if nValues out of range, -3 if out of memory or -4 if arena is full
+{
+    unsigned char compressedVals[MAX_FBC_BYTES*2]; // encoders may write past nValues before failing
+    const unsigned char *pStoreVals=inVals;
+    uint32_t nBytes=nValues;
+    uint32_t state=FBCKV_RAW;
+    if (nValues > MAX_FBC_BYTES)
+        return -2; // values over 64 bytes not supported
+    if (kv->compress && (nValues >= MIN_FBC_BYTES))
+    {
+        const int32_t nBits=fbc264(inVals, compressedVals, nValues); // calls fbc25 for 5 or fewer
+        if ((nBits > 0) && (((uint32_t)nBits + 7) / 8 < nValues))
+        {
+            pStoreVals = compressedVals;
+            nBytes = ((uint32_t)nBits + 7) / 8;
+            state = FBCKV_COMPRESSED;
+        }
+    }
+    uint64_t slot=kvSlot(kv, key);
+    struct fbcKVEntry_s *entry;
+    while (((entry=&kv->entries[slot])->state != FBCKV_EMPTY) && (entry->key != key))
+        slot = (slot + 1) & (kv->tableSize - 1);
+    if ((entry->state == FBCKV_EMPTY) && ((kv->nEntries + 1) * 4 > kv->tableSize * 3))
+    {
+        // grow only for a new key, then find its empty slot in the larger table
+        const int32_t retGrow=kvGrow(kv);
+        if (retGrow < 0)
+            return retGrow;
+        slot = kvSlot(kv, key);
+        while ((entry=&kv->entries[slot])->state != FBCKV_EMPTY)
+            slot = (slot + 1) & (kv->tableSize - 1);
+    }
+    const uint32_t reuseBytes=(entry->state != FBCKV_EMPTY) && (entry->nBytes == nBytes);
+    uint32_t offset=entry->offset;
+    if ((nBytes > FBCKV_INLINE_BYTES) && !reuseBytes)
+    {
+        const int32_t retAlloc=kvAllocBytes(kv, nBytes, &offset);
+        if (retAlloc < 0)
+            return retAlloc;
+    }
+    if (entry->state == FBCKV_EMPTY)
+    {
+        entry->key = key;
+        kv->nEntries++;
+    }
+    else if (!reuseBytes)
+        kvFreeBytes(kv, entry); // replacing with a different size
+    if (nBytes <= FBCKV_INLINE_BYTES)
+    {
+        entry->offset = 0;
+        memcpy(&entry->offset, pStoreVals, nBytes);
+    }
+    else
+    {
+        entry->offset = offset;
+        memcpy(kv->arena + offset, pStoreVals, nBytes);
+    }
+    entry->nValues = (unsigned char)nValues;
+    entry->nBytes = (unsigned char)nBytes;
+    entry->state = (unsigned char)state;
+    return 0;
+} // end fbcKVPut
+
+// -----------------------------------------------------------------------------------
+static inline int32_t fbcKVGet(const struct fbcKV_s *kv, const uint64_t key, unsigned char *outVals)
+// -----------------------------------------------------------------------------------
+// Decode the value stored under key into outVals, which must have room for 64 bytes.
+// Returns number of bytes output, -1 if key not found or other negative if error
+{
+    uint64_t slot=kvSlot(kv, key);
+    const struct fbcKVEntry_s *entry;
+    while ((entry=&kv->entries[slot])->state != FBCKV_EMPTY)
+    {
+        if (entry->key == key)
+        {
+            const unsigned char *pStoredVals=(entry->nBytes <= FBCKV_INLINE_BYTES) ?
+                (const unsigned char *)&entry->offset : kv->arena + entry->offset;
+            if (entry->state == FBCKV_RAW)
+            {
+                memcpy(outVals, pStoredVals, entry->nValues);
+                return entry->nValues;
+            }
+            uint32_t bytesProcessed;
+            return fbc264d(pStoredVals, outVals, entry->nValues, &bytesProcessed);
+        }
+        slot = (slot + 1) & (kv->tableSize - 1);
+    }
+    return -1; // key not found
+} // end fbcKVGet
+
+// -----------------------------------------------------------------------------------
+static inline int32_t fbcKVRemove(struct fbcKV_s *kv, const uint64_t key)
+// -----------------------------------------------------------------------------------
+// Remove key and its value. Returns 0 or -1 if key not found
+{
+    const uint64_t mask=kv->tableSize - 1;
+    uint64_t slot=kvSlot(kv, key);
+    struct fbcKVEntry_s *entries=kv->entries;
+    while (entries[slot].key != key)
+    {
+        if (entries[slot].state == FBCKV_EMPTY)
+            return -1; // key not found
+        slot = (slot + 1) & mask;
+    }
+    if (entries[slot].state == FBCKV_EMPTY)
+        return -1; // key not found
+    kvFreeBytes(kv, &entries[slot]);
+    kv->nEntries--;
+    // shift back following entries that probed past the removed slot
+    uint64_t next=slot;
+    while (1)
+    {
+        next = (next + 1) & mask;
+        if (entries[next].state == FBCKV_EMPTY)
+            break;
+        const uint64_t home=kvSlot(kv, entries[next].key);
+        if (((next - home) & mask) >= ((next - slot) & mask))
+        {
+            entries[slot] = entries[next];
+            slot = next;
+        }
+    }
+    entries[slot].state = FBCKV_EMPTY;
+    return 0;
+} // end fbcKVRemove
+
+#endif /* fbckv_h */
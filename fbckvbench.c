@@ -0,0 +1,123 @@
+//
+//  fbckvbench.c
+//  Benchmark of the fbckv.h key-value store against the same store with compression off
+//
+//  Copyright © 2020 L. Stevan Leonard. All rights reserved.
+//
+
+#include "fbckv.h" // functions are defined static
+
+#include "stdint.h"
+#include "string.h"
+#include "time.h"
+#include <stdio.h>
+
+#define MAX_FILE_SIZE 20000000
+unsigned char inVal[MAX_FILE_SIZE]; // values are consecutive slices of the input file
+uint32_t getNanoseconds[MAX_FILE_SIZE/MIN_FBC_BYTES]; // latency of each get
+
+static uint64_t nowNanoseconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+} // end nowNanoseconds
+
+static int qCompare(const void *v1, const void *v2)
+{
+    if (*(const uint32_t *)v1 < *(const uint32_t *)v2)
+        return -1;
+    if (*(const uint32_t *)v1 > *(const uint32_t *)v2)
+        return 1;
+    return 0;
+} // end qCompare
+
+// -----------------------------------------------------------------------------------
+static int runStore(const uint32_t compress, const uint64_t nValues, const uint32_t valueSize)
+// -----------------------------------------------------------------------------------
+{
+    struct fbcKV_s kv;
+    unsigned char outVals[MAX_FBC_BYTES];
+    uint64_t begin;
+    uint64_t putTime;
+    uint64_t getTime=0;
+    uint64_t key;
+
+    if (fbcKVInit(&kv, nValues, compress) < 0)
+    {
+        printf("fbckvbench error: out of memory\n");
+        return 3;
+    }
+    begin = nowNanoseconds();
+    for (key=0; key<nValues; key++)
+    {
+        if (fbcKVPut(&kv, key, inVal+key*valueSize, valueSize) < 0)
+        {
+            printf("fbckvbench error: put failed for key %llu\n", (unsigned long long)key);
+            return 4;
+        }
+    }
+    putTime = nowNanoseconds() - begin;
+    // get keys in a scattered order, timing each get
+    for (uint64_t i=0; i<nValues; i++)
+    {
+        key = (i * 0x9e3779b1) % nValues;
+        begin = nowNanoseconds();
+        int32_t nBytes=fbcKVGet(&kv, key, outVals);
+        getNanoseconds[i] = (uint32_t)(nowNanoseconds() - begin);
+        getTime += getNanoseconds[i];
+        if ((nBytes != (int32_t)valueSize) || memcmp(outVals, inVal+key*valueSize, valueSize))
+        {
+            printf("fbckvbench error: get failed for key %llu\n", (unsigned long long)key);
+            return 5;
+        }
+    }
+    qsort(getNanoseconds, nValues, sizeof(uint32_t), qCompare);
+    printf("%s   bytes/entry=%.2f   values/entry=%.2f   put=%.1f ns   get mean=%.1f ns   p50=%u ns   p99=%u ns\n",
+           compress ? "compressed  " : "uncompressed", (double)fbcKVMemory(&kv)/nValues, (double)kv.arenaUsed/nValues,
+           (double)putTime/nValues, (double)getTime/nValues, getNanoseconds[nValues/2], getNanoseconds[nValues*99/100]);
+    fbcKVFree(&kv);
+    return 0;
+} // end runStore
+
+// -----------------------------------------------------------------------------------
+int main(int argc, const char * argv[])
+// -----------------------------------------------------------------------------------
+{
+    FILE *f_input;
+    uint32_t valueSize=64;
+    uint64_t nBytes;
+    int ret;
+
+    if (argc < 2)
+    {
+        printf("fbckvbench error: input file must be specified\n");
+        return 14;
+    }
+    f_input = fopen(argv[1], "r");
+    if (!f_input)
+    {
+        printf("fbckvbench error: file not found: %s\n", argv[1]);
+        return 9;
+    }
+    nBytes = fread(inVal, 1, MAX_FILE_SIZE, f_input);
+    fclose(f_input);
+    if (argc >= 3)
+    {
+        int32_t size;
+        sscanf(argv[2], "%d", &size);
+        valueSize = (uint32_t)size;
+    }
+    if ((valueSize < MIN_FBC_BYTES) || (valueSize > MAX_FBC_BYTES))
+    {
+        printf("fbckvbench error: value size must be from %d to %d\n", MIN_FBC_BYTES, MAX_FBC_BYTES);
+        return 3;
+    }
+    const uint64_t nValues=nBytes / valueSize;
+    if (nValues < 1)
+        return 3;
+    printf("Fixed Bit Coding key-value store benchmark\n   file=%s   values=%llu   value size=%u\n", argv[1], (unsigned long long)nValues, valueSize);
+    if ((ret = runStore(0, nValues, valueSize)) != 0)
+        return ret;
+    return runStore(1, nValues, valueSize);
+}
@@ -18,6 +18,16 @@
 #include <math.h>
 
 //#define GEN_STATS
+//#define DEDUP_BLOCKS // use repeat block mode for blocks identical to a recent block
+//#define XOR_BLOCKS // use XOR prediction with previous block, ignored if DEDUP_BLOCKS defined
+//#define REUSE_UNIQUES // reuse uniques of previous fixed bit block, ignored if either of above defined
+//#define FIXED_RATE_BYTES 48 // compress blocks to exactly this many bytes or not at all, ignored if any of above defined
+//#define SKIP_INCOMPRESSIBLE // skip blocks in regions that do not compress, ignored if any of above defined
+//#define PREDICT_MODE // try the mode of the previous block first, ignored if any of above defined
+//#define COMPRESSION_LEVEL 1 // 1 outputs the smallest mode for each block, ignored if any of above defined
+//#define HUFFMAN_BLOCKS // use static Huffman mode with a table trained on the file, ignored if any of above defined
+//#define DECODE_IN_PLACE // decode in one buffer holding the compressed data at its end, for streams fbc264d decodes
+//#define BUFFER_API // compress and decompress the file with fbcCompressBuffer and fbcDecompressBuffer, other options ignored
 #ifdef GEN_STATS
 static double fTotalOutBytes;
 static uint64_t gCountUnableToCompress;
@@ -27,17 +37,26 @@ static uint64_t gCountUniques[MAX_UNIQUES];
 static uint32_t gTextModeCnt;
 static uint32_t gSingleValueModeCnt;
 static uint32_t g7bitCnt;
+static uint32_t gFrameOfReferenceCnt;
+static uint32_t gNibbleModeCnt;
+static uint32_t gFixedAlphabetCnt;
+static uint32_t gRepeatBlockCnt;
+static uint32_t gXorBlockCnt;
+static uint32_t gReuseUniquesCnt;
+static uint32_t gHuffmanBlockCnt;
 #endif
 
 #define MAX_FILE_SIZE 20000000
-unsigned char inVal[MAX_FILE_SIZE]; // read entire file into memory
-unsigned char outVal[MAX_FILE_SIZE]; // encode into memory
+unsigned char inVal[MAX_FILE_SIZE+FBC_SLACK_BYTES]; // read entire file into memory, with slack for fbc264dfast
+unsigned char outVal[MAX_FILE_SIZE+MAX_FILE_SIZE/8]; // encode into memory, with room for fbcCompressBound and to decode in place
 uint64_t gCountBlocks;
 uint64_t total_out_bytes;
 int64_t nBytes_remaining;
 uint64_t nBytes_to_compress;
 int64_t bytes_decompressed;
 uint64_t start_inVal;
+uint64_t rawRunStart; // input start of blocks not compressed that are not yet copied to output
+uint64_t rawRunBytes;
 int64_t compressedInBytes=0;
 double compressedOutBytes=0;
 uint64_t  gCompressedORnot;
@@ -45,6 +64,21 @@ uint64_t gCORN[MAX_FILE_SIZE/128+1]; // store compressed bit info in memory for
 uint32_t gCORNindex;
 uint64_t gCORNblocks;
 uint64_t compressedBlockCount=0;
+#ifdef DEDUP_BLOCKS
+struct fbcDedup_s gDedup; // repeat block state for input stream
+#endif
+#ifdef REUSE_UNIQUES
+struct fbcUniques_s gUniques; // uniques state for encoding or decoding stream
+#endif
+#ifdef SKIP_INCOMPRESSIBLE
+struct fbcSkip_s gSkip; // skip state for input stream
+#endif
+#ifdef PREDICT_MODE
+struct fbcPredict_s gPredict; // mode prediction state for input stream
+#endif
+#ifdef HUFFMAN_BLOCKS
+struct fbcHuffmanTables_s gHuffman; // Huffman tables for encoding and decoding stream
+#endif
 
 static uint32_t top16[256];
 struct top16_s {
@@ -75,6 +109,62 @@ void countTop16(int64_t nValues)
     qsort(&top16_struct, 256, sizeof(struct top16_struct*), qCompare);
 }
 
+#ifdef BUFFER_API
+// -----------------------------------------------------------------------------------
+static int testBufferApi(const char *inName, const int64_t nBytes, const uint32_t blockSize, const int32_t loopCntForTime)
+// -----------------------------------------------------------------------------------
+{
+    // compress the file in inVal to name.fbc and decompress it back to name.fbcd in timed loops
+    char fName[256];
+    FILE *f_out;
+    clock_t begin;
+    double timeSpent;
+    double minTimeSpent=100; // 100 seconds
+    int64_t nOutBytes=0;
+    int64_t nDecodedBytes=0;
+    for (int32_t loopCnt=0; loopCnt<loopCntForTime; loopCnt++)
+    {
+        begin = clock();
+        nOutBytes = fbcCompressBuffer(inVal, (uint64_t)nBytes, outVal, sizeof(outVal), blockSize);
+        timeSpent = (double)(clock()-begin) / (double)CLOCKS_PER_SEC;
+        if (timeSpent < minTimeSpent)
+            minTimeSpent = timeSpent;
+    }
+    if (nOutBytes < 0)
+    {
+        printf("error from fbcCompressBuffer %lld\n", (long long)nOutBytes);
+        return 7;
+    }
+    printf("   compressed byte output=%.2f%%   time=%f sec.   %.0f bytes per second   inbytes=%lld   outbytes=%lld\n", (float)100*(1.0-(float)nOutBytes/nBytes), minTimeSpent, (float)nBytes/minTimeSpent, (long long)nBytes, (long long)nOutBytes);
+    strcpy(fName, inName);
+    f_out = fopen(strcat(fName, ".fbc"), "w");
+    if (!f_out || (fwrite(outVal, 1, (uint64_t)nOutBytes, f_out) < (uint64_t)nOutBytes))
+        return 7;
+    fclose(f_out);
+    minTimeSpent = 100;
+    for (int32_t loopCnt=0; loopCnt<loopCntForTime; loopCnt++)
+    {
+        begin = clock();
+        nDecodedBytes = fbcDecompressBuffer(outVal, (uint64_t)nOutBytes, inVal, sizeof(inVal));
+        timeSpent = (double)(clock()-begin) / (double)CLOCKS_PER_SEC;
+        if (timeSpent < minTimeSpent)
+            minTimeSpent = timeSpent;
+    }
+    if (nDecodedBytes < 0)
+    {
+        printf("error from fbcDecompressBuffer %lld\n", (long long)nDecodedBytes);
+        return 8;
+    }
+    f_out = fopen(strcat(fName, "d"), "w");
+    if (!f_out)
+        return 8;
+    fwrite(inVal, 1, (uint64_t)nDecodedBytes, f_out);
+    fclose(f_out);
+    printf("fbcDecompressBuffer bytes per second=%.0lf   time=%f sec.\n   inbytes=%lld   outbytes=%lld\n", (float)nDecodedBytes/(float)minTimeSpent, minTimeSpent, (long long)nOutBytes, (long long)nDecodedBytes);
+    return 0;
+} // end testBufferApi
+#endif
+
 // -----------------------------------------------------------------------------------
 int main(int argc, const char * argv[])
 // -----------------------------------------------------------------------------------
@@ -104,7 +194,7 @@ int main(int argc, const char * argv[])
         printf("fbc error: file not found: %s\n", fName);
         return 9;
     }
-    printf("Fixed Bit Coding v1.7\n   file=%s\n", fName);
+    printf("Fixed Bit Coding v1.8\n   file=%s\n", fName);
     fseek(f_input, 0, SEEK_END); // set to end of file
     if (ftell(f_input) > MAX_FILE_SIZE)
     {
@@ -126,15 +216,19 @@ int main(int argc, const char * argv[])
         sscanf(argv[2], "%d", &blockSize);
         uintBlockSize = (uint32_t)blockSize;
     }
-    if ((uintBlockSize < MIN_FBC_BYTES) || (uintBlockSize > MAX_FBC_BYTES))
+    if ((uintBlockSize < MIN_FBC_BYTES) || (uintBlockSize > MAX_FBC_LARGE_BYTES))
     {
-        printf("fbc error: block size must be from %d to %d\n", MIN_FBC_BYTES, MAX_FBC_BYTES);
+        printf("fbc error: block size must be from %d to %d\n", MIN_FBC_BYTES, MAX_FBC_LARGE_BYTES);
         return 3;
     }
     countTop16(nBytes); // use to find the ordering of top 16 for text mode characters
+#ifdef HUFFMAN_BLOCKS
+    fbcHuffmanTablesInit(&gHuffman);
+    fbcHuffmanTablesAdd(&gHuffman, top16); // train a table on the counts of the file
+#endif
         
     unsigned char blockSize;
-    blockSize = (unsigned char)uintBlockSize;
+    blockSize = (unsigned char)uintBlockSize; // block size of 256 is written as 0
     uint64_t nBytesWritten = fwrite(outVal, 1, total_out_bytes, f_out);
     if (nBytesWritten < total_out_bytes)
         return 7;
@@ -144,6 +238,11 @@ int main(int argc, const char * argv[])
         sscanf(argv[3], "%d", &loopCntForTime);
     if (loopCntForTime < 1 || loopCntForTime > 1000000)
         loopCntForTime = 1;
+#ifdef BUFFER_API
+    fclose(f_out);
+    fclose(f_compressedORnot);
+    return testBufferApi(argv[1], nBytes, uintBlockSize, loopCntForTime);
+#endif
 
 COMPRESS_TIMED_LOOP:
     begin = clock();
@@ -152,6 +251,19 @@ COMPRESS_TIMED_LOOP:
     start_inVal = 0;
     gCORNindex = 0;
     gCORNblocks = 0;
+    rawRunBytes = 0;
+#ifdef DEDUP_BLOCKS
+    fbcDedupInit(&gDedup);
+#endif
+#ifdef REUSE_UNIQUES
+    fbcUniquesInit(&gUniques);
+#endif
+#ifdef SKIP_INCOMPRESSIBLE
+    fbcSkipInit(&gSkip);
+#endif
+#ifdef PREDICT_MODE
+    fbcPredictInit(&gPredict);
+#endif
 #ifdef GEN_STATS
     fTotalOutBytes = 1.0; // block size
 #endif
@@ -160,8 +272,10 @@ COMPRESS_TIMED_LOOP:
         nBytes_to_compress = (uint64_t)(nBytes_remaining<(long)uintBlockSize ? nBytes_remaining : (long)uintBlockSize);
         if (nBytes_to_compress < uintBlockSize)
         {
-            // last bytes less than uintBlockSize are output uncompressed
-            memcpy(outVal+total_out_bytes, inVal+start_inVal, nBytes_to_compress);
+            // last bytes less than uintBlockSize are output uncompressed with any raw run before them
+            if (rawRunBytes == 0)
+                rawRunStart = start_inVal;
+            rawRunBytes += nBytes_to_compress;
             total_out_bytes += nBytes_to_compress;
 #ifdef GEN_STATS
             fTotalOutBytes += nBytes_to_compress;
@@ -177,8 +291,28 @@ COMPRESS_TIMED_LOOP:
         gCountBlocks++; // global count of blocks processed
         if (uintBlockSize < 6)
             nbout = fbc25(inVal+start_inVal, outVal+total_out_bytes, uintBlockSize);
+        else if (uintBlockSize > MAX_FBC_BYTES)
+            nbout = fbc264(inVal+start_inVal, outVal+total_out_bytes, uintBlockSize); // large blocks
         else
+#ifdef DEDUP_BLOCKS
+            nbout = fbc264dedup(&gDedup, inVal+start_inVal, outVal+total_out_bytes, uintBlockSize);
+#elif defined(XOR_BLOCKS)
+            nbout = fbc264xor(inVal+start_inVal, outVal+total_out_bytes, uintBlockSize, start_inVal ? inVal+start_inVal-uintBlockSize : NULL);
+#elif defined(REUSE_UNIQUES)
+            nbout = fbc264reuse(&gUniques, inVal+start_inVal, outVal+total_out_bytes, uintBlockSize);
+#elif defined(FIXED_RATE_BYTES)
+            nbout = fbc264fixedrate(inVal+start_inVal, outVal+total_out_bytes, uintBlockSize, FIXED_RATE_BYTES < uintBlockSize ? FIXED_RATE_BYTES : uintBlockSize - 1) * 8;
+#elif defined(SKIP_INCOMPRESSIBLE)
+            nbout = fbc264skip(&gSkip, inVal+start_inVal, outVal+total_out_bytes, uintBlockSize);
+#elif defined(PREDICT_MODE)
+            nbout = fbc264predict(&gPredict, inVal+start_inVal, outVal+total_out_bytes, uintBlockSize);
+#elif defined(COMPRESSION_LEVEL)
+            nbout = fbc264level(inVal+start_inVal, outVal+total_out_bytes, uintBlockSize, COMPRESSION_LEVEL);
+#elif defined(HUFFMAN_BLOCKS)
+            nbout = fbc264huffman(&gHuffman, inVal+start_inVal, outVal+total_out_bytes, uintBlockSize);
+#else
             nbout = fbc264(inVal+start_inVal, outVal+total_out_bytes, uintBlockSize);
+#endif
         if (nbout < 0)
         {
             if (nbout == -1)
@@ -196,8 +330,11 @@ COMPRESS_TIMED_LOOP:
         }
         else if (nbout == 0)
         {
-            // unable to compress: output original vals and use gCompressedORnot to record
-            memcpy(outVal+total_out_bytes, inVal+start_inVal, uintBlockSize);
+            // unable to compress: extend the run of original vals copied to output when it ends,
+            // which also replaces any bytes the encoder wrote there, and use gCompressedORnot to record
+            if (rawRunBytes == 0)
+                rawRunStart = start_inVal;
+            rawRunBytes += uintBlockSize;
             total_out_bytes += uintBlockSize;
             gCompressedORnot <<= 1; // 0 indicates not compressed
 #ifdef GEN_STATS
@@ -208,6 +345,12 @@ COMPRESS_TIMED_LOOP:
         else
         {
             // compressed output
+            if (rawRunBytes)
+            {
+                // copy the run of original vals ending at this block in one move
+                memcpy(outVal+total_out_bytes-rawRunBytes, inVal+rawRunStart, rawRunBytes);
+                rawRunBytes = 0;
+            }
 #ifdef GEN_STATS
             fTotalOutBytes += (float)nbout / 8.0;
             if (uintBlockSize < 6)
@@ -241,10 +384,24 @@ COMPRESS_TIMED_LOOP:
                     {
                         if (outVal[total_out_bytes] == 0)
                             gTextModeCnt++; // text mode encoding
-                        else if ((outVal[total_out_bytes] & 0x20) > 0)
+                        else if (outVal[total_out_bytes] == 0x20)
                             gSingleValueModeCnt++; // single value mode encoding
-                        else if ((outVal[total_out_bytes] & 0x40) > 0)
+                        else if (outVal[total_out_bytes] == 0x40)
                             g7bitCnt++; // 7-bit encoding
+                        else if (outVal[total_out_bytes] == 0x60)
+                            gFrameOfReferenceCnt++; // frame of reference encoding
+                        else if (outVal[total_out_bytes] == 0x80)
+                            gNibbleModeCnt++; // nibble mode encoding
+                        else if (outVal[total_out_bytes] == 0xa0)
+                            gFixedAlphabetCnt++; // fixed alphabet encoding
+                        else if (outVal[total_out_bytes] == 0xc0)
+                            gRepeatBlockCnt++; // repeat block encoding
+                        else if ((outVal[total_out_bytes] == 0xe0) && ((outVal[total_out_bytes+1] & 0xf) == EXTENDED_XOR_MODE))
+                            gXorBlockCnt++; // XOR prediction encoding
+                        else if ((outVal[total_out_bytes] == 0xe0) && ((outVal[total_out_bytes+1] & 0xf) == EXTENDED_UNIQUES_MODE))
+                            gReuseUniquesCnt++; // unique reuse encoding
+                        else if ((outVal[total_out_bytes] == 0xe0) && ((outVal[total_out_bytes+1] & 0xf) == EXTENDED_HUFFMAN_MODE))
+                            gHuffmanBlockCnt++; // static Huffman encoding
                     }
                     else
                     {
@@ -271,6 +428,8 @@ COMPRESS_TIMED_LOOP:
             gCORN[gCORNindex++] = gCompressedORnot;
         }
     }
+    if (rawRunBytes)
+        memcpy(outVal+total_out_bytes-rawRunBytes, inVal+rawRunStart, rawRunBytes); // copy run of original vals at end
     end = clock();
     timeSpent = (double)(end-begin) / (double)CLOCKS_PER_SEC;
     if (timeSpent < minTimeSpent)
@@ -299,15 +458,31 @@ COMPRESS_TIMED_LOOP:
     printf("   compressed byte output=%.2f%%   within compressed blocks=%.2lf%%\n   time=%f sec.   %.0f bytes per second   inbytes=%lld   outbytes=%llu\n   outbytes/block=%.2f   block size=%d   loop count=%d\n", (float)100*(1.0-(float)(total_out_bytes+gCORNbytes)/nBytes), (float)100*(1.0-(float)compressedOutBytes/(float)compressedInBytes),  minTimeSpent, (float)nBytes/minTimeSpent, nBytes, total_out_bytes+gCORNbytes, (float)(total_out_bytes+gCORNbytes)/nBytes*(float)uintBlockSize, uintBlockSize, loopCnt);
 #ifdef GEN_STATS
     uint64_t compressedBlocks=gCountBlocks-gCountUnableToCompress;
-    uint64_t fbcBlocks=compressedBlocks-gTextModeCnt-g7bitCnt-gSingleValueModeCnt;
+    uint64_t fbcBlocks=compressedBlocks-gTextModeCnt-g7bitCnt-gSingleValueModeCnt-gFrameOfReferenceCnt-gNibbleModeCnt-gFixedAlphabetCnt-gRepeatBlockCnt-gXorBlockCnt-gReuseUniquesCnt-gHuffmanBlockCnt;
     printf("   compressed bit output=%.2f%%   uncompressed blocks=%.2f%%\n   fixed bit coding blocks: %llu  %.01f%% total blocks  %.01f%% compressed blocks\n      average # uniques=%.2f  1 unique=%.2f%%  2 nibbles=%.2f%%  2 u=%.2f%%  3 u=%.2f%%  4 u=%.2f%%  5 u=%.2f%%  6 u=%.2f%%  7 u=%.2f%%  8 u=%.2f%%  9 u=%.2f%%  10 u=%.2f%%  11 u=%.2f%%  12 u=%.2f%%  13 u=%.2f%%  14 u=%.2f%%  15 u=%.2f%%  16 u=%.2f%%\n", (1.0-(fTotalOutBytes+gCORNbytes)/(float)nBytes)*100,   (float)gCountUnableToCompress/(float)gCountBlocks*100, fbcBlocks/loopCnt, (float)fbcBlocks/(float)gCountBlocks*100, (float)fbcBlocks/(float)compressedBlocks*100,
         (float)gCountAverageUniques/fbcBlocks, (float)gCountUniques[0]/fbcBlocks*100, (float)gCountNibbles/fbcBlocks*100, (float)gCountUniques[1]/fbcBlocks*100, (float)gCountUniques[2]/fbcBlocks*100, (float)gCountUniques[3]/fbcBlocks*100, (float)gCountUniques[4]/fbcBlocks*100, (float)gCountUniques[5]/fbcBlocks*100, (float)gCountUniques[6]/fbcBlocks*100, (float)gCountUniques[7]/fbcBlocks*100, (float)gCountUniques[8]/fbcBlocks*100, (float)gCountUniques[9]/fbcBlocks*100, (float)gCountUniques[10]/fbcBlocks*100, (float)gCountUniques[11]/compressedBlocks*100, (float)gCountUniques[12]/fbcBlocks*100, (float)gCountUniques[13]/fbcBlocks*100, (float)gCountUniques[14]/fbcBlocks*100, (float)gCountUniques[15]/fbcBlocks*100);
     printf("   text mode blocks: %d  %.01f%% total blocks  %.01f%% compressed blocks\n", gTextModeCnt/loopCnt, (float)gTextModeCnt/(float)gCountBlocks*100, (float)gTextModeCnt/(float)compressedBlocks*100);
     printf("   single value mode blocks: %d  %.01f%% total blocks  %.01f%% compressed blocks\n", gSingleValueModeCnt/loopCnt, (float)gSingleValueModeCnt/(float)gCountBlocks*100, (float)gSingleValueModeCnt/(float)compressedBlocks*100);
     printf("   7-bit mode blocks: %d  %.01f%% total blocks  %.01f%% compressed blocks\n", g7bitCnt/loopCnt, (float)g7bitCnt/(float)gCountBlocks*100, (float)g7bitCnt/(float)compressedBlocks*100);
+    printf("   frame of reference mode blocks: %d  %.01f%% total blocks  %.01f%% compressed blocks\n", gFrameOfReferenceCnt/loopCnt, (float)gFrameOfReferenceCnt/(float)gCountBlocks*100, (float)gFrameOfReferenceCnt/(float)compressedBlocks*100);
+    printf("   nibble mode blocks: %d  %.01f%% total blocks  %.01f%% compressed blocks\n", gNibbleModeCnt/loopCnt, (float)gNibbleModeCnt/(float)gCountBlocks*100, (float)gNibbleModeCnt/(float)compressedBlocks*100);
+    printf("   fixed alphabet mode blocks: %d  %.01f%% total blocks  %.01f%% compressed blocks\n", gFixedAlphabetCnt/loopCnt, (float)gFixedAlphabetCnt/(float)gCountBlocks*100, (float)gFixedAlphabetCnt/(float)compressedBlocks*100);
+    printf("   repeat block mode blocks: %d  %.01f%% total blocks  %.01f%% compressed blocks\n", gRepeatBlockCnt/loopCnt, (float)gRepeatBlockCnt/(float)gCountBlocks*100, (float)gRepeatBlockCnt/(float)compressedBlocks*100);
+    printf("   XOR prediction blocks: %d  %.01f%% total blocks  %.01f%% compressed blocks\n", gXorBlockCnt/loopCnt, (float)gXorBlockCnt/(float)gCountBlocks*100, (float)gXorBlockCnt/(float)compressedBlocks*100);
+    printf("   unique reuse blocks: %d  %.01f%% total blocks  %.01f%% compressed blocks\n", gReuseUniquesCnt/loopCnt, (float)gReuseUniquesCnt/(float)gCountBlocks*100, (float)gReuseUniquesCnt/(float)compressedBlocks*100);
+    printf("   static Huffman blocks: %d  %.01f%% total blocks  %.01f%% compressed blocks\n", gHuffmanBlockCnt/loopCnt, (float)gHuffmanBlockCnt/(float)gCountBlocks*100, (float)gHuffmanBlockCnt/(float)compressedBlocks*100);
+#ifdef SKIP_INCOMPRESSIBLE
+    printf("   skipped blocks: %llu  %.01f%% total blocks\n", (unsigned long long)gSkip.nSkippedBlocks, (float)gSkip.nSkippedBlocks*loopCnt/(float)gCountBlocks*100);
+#endif
+#ifdef PREDICT_MODE
+    printf("   predicted mode blocks: %llu  %.01f%% total blocks\n", (unsigned long long)gPredict.nHits, (float)gPredict.nHits*loopCnt/(float)gCountBlocks*100);
+#endif
 #endif
     
     // decompress output ------------------------------------
+#ifdef DECODE_IN_PLACE
+    const uint64_t inPlaceSize=fbcInPlaceBound((uint64_t)nBytes, uintBlockSize); // nBytes is the original size
+#endif
     f_input = fopen(fName, "r");
     f_out = fopen(strcat(fName, "d"), "w");
     nBytes = (long)fread(&inVal, 1, total_out_bytes , f_input);
@@ -321,49 +496,93 @@ DECOMPRESS_TIMED_LOOP:
     gCORNblocks = 0;
     gCORNindex = 0; // point at first block of compressed bits
     gCompressedORnot = gCORN[gCORNindex++]; // get first block
+#ifdef REUSE_UNIQUES
+    fbcUniquesInit(&gUniques);
+#endif
     nBytes_remaining = nBytes;
     total_out_bytes = 0;
     start_inVal = 0;
+#ifdef DECODE_IN_PLACE
+    memcpy(outVal+inPlaceSize-nBytes, inVal, (uint64_t)nBytes); // compressed data at end of buffer
+#endif
     begin = clock();
+#ifdef DECODE_IN_PLACE
+    bytes_decompressed = fbcStreamDecodeInPlace(outVal, inPlaceSize, (uint64_t)nBytes, gCORN, uintBlockSize);
+    if (bytes_decompressed < 1)
+    {
+        fclose(f_out);
+        fclose(f_compressedORnot);
+        printf("error from fbcStreamDecodeInPlace %lld\n", (long long)bytes_decompressed);
+        goto COMPRESS_DATA;
+    }
+    total_out_bytes = (uint64_t)bytes_decompressed;
+    nBytes_remaining = 0; // all blocks decoded
+#endif
     while (nBytes_remaining > 0)
     {
-        // check whether to decompress or copy uncompressed data to output
-        gCountBlocks++;
+        // process the run of uncompressed or compressed blocks at the top of the compressed
+        // or not bits, up to the end of this set of 64 bits
+        uint32_t nRunBlocks;
+        const uint32_t nSetBlocks=64 - (gCORNblocks & 0x3f);
         if ((gCompressedORnot & 0x8000000000000000) == 0)
         {
-            // uncompressed input block
-            uint64_t outBytes;
-            if ((uint64_t)nBytes_remaining < uintBlockSize)
+            // run of uncompressed input blocks copied at once
+            nRunBlocks = leadingZeros64(gCompressedORnot);
+            if (nRunBlocks > nSetBlocks)
+                nRunBlocks = nSetBlocks;
+            uint64_t outBytes=(uint64_t)nRunBlocks * uintBlockSize;
+            if ((uint64_t)nBytes_remaining < outBytes)
                 outBytes = (uint64_t)nBytes_remaining; // last block in file
-            else
-                outBytes = uintBlockSize;
             memcpy(outVal+total_out_bytes, inVal+start_inVal, outBytes);
             total_out_bytes += outBytes;
             start_inVal += outBytes;
             nBytes_remaining -= outBytes;
+            gCountBlocks += nRunBlocks;
         }
         else
         {
-            // compressed input block
-            if (uintBlockSize < 6)
-                bytes_decompressed = fbc25d(inVal+start_inVal, outVal+total_out_bytes, uintBlockSize, &bytes_processed);
-            else
-                bytes_decompressed = fbc264d(inVal+start_inVal, outVal+total_out_bytes, uintBlockSize, &bytes_processed);
-            if (bytes_decompressed < 1)
+            // run of compressed input blocks
+            nRunBlocks = leadingZeros64(~gCompressedORnot);
+            if (nRunBlocks > nSetBlocks)
+                nRunBlocks = nSetBlocks;
+            for (uint32_t i=0; i<nRunBlocks; i++)
             {
-                fwrite(outVal, 1, total_out_bytes, f_out);
-                fclose(f_out);
-                fclose(f_compressedORnot);
-                printf("error from fbc264d\n");
-                goto COMPRESS_DATA;
+                if (uintBlockSize < 6)
+                    bytes_decompressed = fbc25d(inVal+start_inVal, outVal+total_out_bytes, uintBlockSize, &bytes_processed);
+                else if (uintBlockSize > MAX_FBC_BYTES)
+                    bytes_decompressed = fbc264dfast(inVal+start_inVal, outVal+total_out_bytes, uintBlockSize, &bytes_processed);
+                else
+#ifdef DEDUP_BLOCKS
+                    bytes_decompressed = fbc264ddedup(inVal+start_inVal, outVal+total_out_bytes, uintBlockSize, &bytes_processed);
+#elif defined(XOR_BLOCKS)
+                    bytes_decompressed = fbc264dxor(inVal+start_inVal, outVal+total_out_bytes, uintBlockSize, total_out_bytes ? outVal+total_out_bytes-uintBlockSize : NULL, &bytes_processed);
+#elif defined(REUSE_UNIQUES)
+                    bytes_decompressed = fbc264dreuse(&gUniques, inVal+start_inVal, outVal+total_out_bytes, uintBlockSize, &bytes_processed);
+#elif defined(FIXED_RATE_BYTES)
+                    bytes_decompressed = fbc264dfixedrate(inVal+start_inVal, outVal+total_out_bytes, uintBlockSize, FIXED_RATE_BYTES < uintBlockSize ? FIXED_RATE_BYTES : uintBlockSize - 1, &bytes_processed);
+#elif defined(HUFFMAN_BLOCKS)
+                    bytes_decompressed = fbc264dhuffman(&gHuffman, inVal+start_inVal, outVal+total_out_bytes, uintBlockSize, &bytes_processed);
+#else
+                    bytes_decompressed = fbc264dfast(inVal+start_inVal, outVal+total_out_bytes, uintBlockSize, &bytes_processed);
+#endif
+                if (bytes_decompressed < 1)
+                {
+                    fwrite(outVal, 1, total_out_bytes, f_out);
+                    fclose(f_out);
+                    fclose(f_compressedORnot);
+                    printf("error from fbc264d\n");
+                    goto COMPRESS_DATA;
+                }
+                total_out_bytes += (uint64_t)bytes_decompressed;
+                start_inVal += (uint64_t)bytes_processed;
+                nBytes_remaining -= bytes_processed;
             }
-            total_out_bytes += (uint64_t)bytes_decompressed;
-            start_inVal += (uint64_t)bytes_processed;
-            nBytes_remaining -= bytes_processed;
+            gCountBlocks += nRunBlocks;
         }
-        if (++gCORNblocks & 0x3f)
+        gCORNblocks += nRunBlocks;
+        if (gCORNblocks & 0x3f)
         {
-            gCompressedORnot <<= 1;
+            gCompressedORnot <<= nRunBlocks;
         }
         else
         {